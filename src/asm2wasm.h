@@ -1459,19 +1459,19 @@ void Asm2WasmBuilder::processAsm(Ref ast) {
                                                expressionStack[i - 1]->is<Loop>() ||
                                                expressionStack[i - 1]->is<If>());
             if (i == 0 || parentIsStructure || exp->type == none || exp->type == unreachable) {
-              if (debugLocations.count(exp) > 0) {
+              if (debugLocations.has(exp)) {
                 // already present, so look back up
                 i++;
                 while (i < expressionStack.size()) {
                   exp = expressionStack[i];
-                  if (debugLocations.count(exp) == 0) {
-                    debugLocations[exp] = { fileIndex, lineNumber, 0 };
+                  if (!debugLocations.has(exp)) {
+                    debugLocations.set(exp, { fileIndex, lineNumber, 0 });
                     break;
                   }
                   i++;
                 }
               } else {
-                debugLocations[exp] = { fileIndex, lineNumber, 0 };
+                debugLocations.set(exp, { fileIndex, lineNumber, 0 });
               }
               break;
             }
@@ -136,8 +136,11 @@ Expression* flexibleCopy(Expression* original, Module& wasm, CustomCopier custom
       return builder.makeReturn(copy(curr->value));
     }
     Expression* visitHost(Host *curr) {
-      assert(curr->operands.size() == 0);
-      return builder.makeHost(curr->op, curr->nameOperand, {});
+      std::vector<Expression*> operands;
+      for (Index i = 0; i < curr->operands.size(); i++) {
+        operands.push_back(copy(curr->operands[i]));
+      }
+      return builder.makeHost(curr->op, curr->nameOperand, std::move(operands));
     }
     Expression* visitNop(Nop *curr) {
       return builder.makeNop();
@@ -168,6 +171,31 @@ void spliceIntoBlock(Block* block, Index index, Expression* add) {
   block->finalize(block->type);
 }
 
+static_assert(sizeof(Nop) >= sizeof(void*), "recycled nodes must fit a free list link");
+
+void recycle(Expression* curr, Module& wasm, Function* func) {
+  if (func && !func->debugLocations.empty()) {
+    func->debugLocations.erase(curr);
+  }
+  wasm.allocator.recycle(curr, curr->_id);
+}
+
+void recycleRecursively(Expression* curr, Module& wasm, Function* func) {
+  struct Recycler : public PostWalker<Recycler, UnifiedExpressionVisitor<Recycler>> {
+    Module& wasm;
+    Function* func;
+
+    Recycler(Module& wasm, Function* func) : wasm(wasm), func(func) {}
+
+    // children are visited before their parents, so a node is only
+    // recycled once nothing more will be read from it
+    void visitExpression(Expression* curr) {
+      recycle(curr, wasm, func);
+    }
+  };
+  Recycler(wasm, func).walk(curr);
+}
+
 } // namespace ExpressionManipulator
 
 } // namespace wasm
@@ -17,8 +17,12 @@
 #ifndef wasm_ast_effects_h
 #define wasm_ast_effects_h
 
+#include <unordered_map>
+
 namespace wasm {
 
+struct EffectCache;
+
 // Look for side effects, including control flow
 // TODO: optimize
 
@@ -32,6 +36,12 @@ struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
   bool ignoreImplicitTraps;
   bool debugInfo;
 
+  // when walking with a cache, subtrees whose effects are in it are not
+  // walked again, their effects are merged in instead
+  EffectCache* cache = nullptr;
+
+  static void scan(EffectAnalyzer* self, Expression** currp);
+
   void analyze(Expression *ast) {
     breakNames.clear();
     walk(ast);
@@ -251,6 +261,89 @@ struct EffectAnalyzer : public PostWalker<EffectAnalyzer> {
   void visitUnreachable(Unreachable *curr) { branches = true; }
 };
 
+// Caches the effects of expressions, for passes that look at the effects of
+// the same code many times, like at each level of a deep nest of expressions.
+// Analyzing an expression reuses the cached effects of its subtrees, so it
+// costs in proportion to the code not analyzed before. Only big enough
+// subtrees are cached, as small ones are quicker to just walk again.
+//
+// Cached effects are of the code as it was when analyzed, so a pass must
+// erase() an expression it modifies or replaces, and clear() the cache when
+// it modifies code that cached expressions may contain, or recycles nodes
+// (their memory can be reused by new ones).
+
+struct EffectCache {
+  EffectCache(PassOptions& passOptions) : passOptions(passOptions) {}
+
+  EffectAnalyzer get(Expression* curr) {
+    // if curr itself is cached, the walk just merges that in
+    EffectAnalyzer effects(passOptions);
+    walked = 0;
+    effects.cache = this;
+    effects.walk(curr);
+    effects.cache = nullptr;
+    // as in EffectAnalyzer::analyze, breaks left over are external, but
+    // cache what we had without them for when this is merged into a parent,
+    // which may be their target
+    bool branchesWithoutBreaks = effects.branches;
+    if (effects.breakNames.size() > 0) effects.branches = true;
+    if (walked >= MinSize && entries.count(curr) == 0) {
+      entries.emplace(curr, Entry{ effects, branchesWithoutBreaks, walked });
+    }
+    return effects;
+  }
+
+  void erase(Expression* curr) {
+    entries.erase(curr);
+  }
+
+  void clear() {
+    entries.clear();
+  }
+
+private:
+  friend struct EffectAnalyzer;
+
+  struct Entry {
+    EffectAnalyzer effects;
+    bool branchesWithoutBreaks;
+    Index size; // the number of nodes
+  };
+
+  static const Index MinSize = 32;
+
+  PassOptions& passOptions;
+  std::unordered_map<Expression*, Entry> entries;
+  Index walked; // the size of what the current get() walked
+};
+
+inline void EffectAnalyzer::scan(EffectAnalyzer* self, Expression** currp) {
+  auto* cache = self->cache;
+  if (cache && !cache->entries.empty()) {
+    auto iter = cache->entries.find(*currp);
+    if (iter != cache->entries.end()) {
+      // like mergeIn, but of everything, and with breaks still to resolve
+      auto& entry = iter->second;
+      auto& other = entry.effects;
+      self->branches = self->branches || entry.branchesWithoutBreaks;
+      self->calls = self->calls || other.calls;
+      self->readsMemory = self->readsMemory || other.readsMemory;
+      self->writesMemory = self->writesMemory || other.writesMemory;
+      self->implicitTrap = self->implicitTrap || other.implicitTrap;
+      self->isAtomic = self->isAtomic || other.isAtomic;
+      self->localsRead.insert(other.localsRead.begin(), other.localsRead.end());
+      self->localsWritten.insert(other.localsWritten.begin(), other.localsWritten.end());
+      self->globalsRead.insert(other.globalsRead.begin(), other.globalsRead.end());
+      self->globalsWritten.insert(other.globalsWritten.begin(), other.globalsWritten.end());
+      self->breakNames.insert(other.breakNames.begin(), other.breakNames.end());
+      cache->walked += entry.size;
+      return;
+    }
+  }
+  if (cache) cache->walked++;
+  PostWalker<EffectAnalyzer>::scan(self, currp);
+}
+
 } // namespace wasm
 
 #endif // wasm_ast_effects_h
@@ -61,6 +61,16 @@ namespace ExpressionManipulator {
 
   // Splice an item into the middle of a block's list
   void spliceIntoBlock(Block* block, Index index, Expression* add);
+
+  // Hands the memory of a node that is no longer referenced from anywhere
+  // back to the module's allocator, so that Builder can reuse it for a new
+  // node of the same kind. The node must never be looked at again, so only
+  // do this when nothing, including the pass doing it, still refers to it.
+  // If it was in a function, any debug info for it is dropped as well.
+  void recycle(Expression* curr, Module& wasm, Function* func);
+
+  // Recycles a node and all of its children.
+  void recycleRecursively(Expression* curr, Module& wasm, Function* func);
 }
 
 } // wasm
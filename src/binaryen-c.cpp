@@ -983,11 +983,27 @@ BinaryenModuleRef BinaryenModuleRead(char* input, size_t inputSize) {
   }
 
   auto* wasm = new Module;
-  std::vector<char> buffer(false);
-  buffer.resize(inputSize);
-  std::copy_n(input, inputSize, buffer.begin());
   try {
-    WasmBinaryBuilder parser(*wasm, buffer, false);
+    WasmBinaryBuilder parser(*wasm, input, inputSize, false);
+    parser.read();
+  } catch (ParseException& p) {
+    p.dump(std::cerr);
+    Fatal() << "error in parsing wasm binary";
+  }
+  return wasm;
+}
+
+BinaryenModuleRef BinaryenModuleReadLazy(char* input, size_t inputSize) {
+  if (tracing) {
+    std::cout << "  // BinaryenModuleReadLazy\n";
+  }
+
+  auto* wasm = new Module;
+  // the function bodies point into the input, so it must outlive them
+  auto copy = std::make_shared<std::vector<char>>(input, input + inputSize);
+  try {
+    WasmBinaryBuilder parser(*wasm, copy->data(), copy->size(), false);
+    parser.setLazy(copy);
     parser.read();
   } catch (ParseException& p) {
     p.dump(std::cerr);
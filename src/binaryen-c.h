@@ -394,6 +394,11 @@ size_t BinaryenModuleWrite(BinaryenModuleRef module, char* output, size_t output
 // Deserialize a module from binary form.
 BinaryenModuleRef BinaryenModuleRead(char* input, size_t inputSize);
 
+// Deserialize a module from binary form, decoding function bodies only when
+// they are needed, for example by passes. Bodies that never are get written
+// out as they were read. The input is copied.
+BinaryenModuleRef BinaryenModuleReadLazy(char* input, size_t inputSize);
+
 // Execute a module in the Binaryen interpreter. This will create an instance of
 // the module, run it in the interpreter - which means running the start method -
 // and then destroying the instance.
@@ -59,6 +59,63 @@ struct IString {
     }
   };
 
+  // The global store of interned strings. It is split into shards by hash,
+  // each with its own lock, so threads interning different strings rarely
+  // contend with each other. Strings that we must copy are placed in large
+  // chunks owned by their shard, and live until the end of the process.
+  class Table {
+    typedef std::unordered_set<const char *, CStringHash, CStringEqual> StringSet;
+
+    static const size_t NumShards = 64;
+    static const size_t ChunkSize = 64 * 1024;
+
+    struct Shard {
+      std::mutex mutex;
+      StringSet strings;
+      std::vector<std::unique_ptr<char[]>> chunks;
+      char* pos = nullptr;
+      size_t left = 0;
+
+      const char* copy(const char *s) {
+        size_t size = strlen(s) + 1;
+        if (size > ChunkSize / 4) {
+          // too big to share a chunk
+          chunks.emplace_back(new char[size]);
+          memcpy(chunks.back().get(), s, size);
+          return chunks.back().get();
+        }
+        if (size > left) {
+          chunks.emplace_back(new char[ChunkSize]);
+          pos = chunks.back().get();
+          left = ChunkSize;
+        }
+        char* ret = pos;
+        memcpy(ret, s, size);
+        pos += size;
+        left -= size;
+        return ret;
+      }
+    };
+
+  public:
+    // Returns the canonical pointer for a string, adding it if it is new.
+    static const char* intern(const char *s, bool reuse) {
+      static Shard shards[NumShards];
+      size_t hash = hash_c(s);
+      auto& shard = shards[(hash ^ (hash >> 16)) % NumShards];
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto existing = shard.strings.find(s);
+      if (existing != shard.strings.end()) {
+        return *existing;
+      }
+      if (!reuse) {
+        s = shard.copy(s); // we'll never modify it, so this is ok
+      }
+      shard.strings.insert(s);
+      return s;
+    }
+  };
+
   IString() : str(nullptr) {}
   IString(const char *s, bool reuse=true) { // if reuse=true, then input is assumed to remain alive; not copied
     assert(s);
@@ -67,33 +124,17 @@ struct IString {
 
   void set(const char *s, bool reuse=true) {
     typedef std::unordered_set<const char *, CStringHash, CStringEqual> StringSet;
-    // one global store of strings per thread, we must not access this
-    // in parallel
+    // one store of strings per thread, we must not access this in parallel.
+    // this caches lookups in the global table, so each thread goes there
+    // only once per string
     thread_local static StringSet strings;
 
     auto existing = strings.find(s);
 
     if (existing == strings.end()) {
-      // if the string isn't already known, we must use a single global
-      // storage location, guarded by a mutex, so each string is allocated
-      // exactly once
-      static std::mutex mutex;
-      std::unique_lock<std::mutex> lock(mutex);
-      // a single global set contains the actual strings, so we allocate each one
-      // exactly once.
-      static StringSet globalStrings;
-      auto globalExisting = globalStrings.find(s);
-      if (globalExisting == globalStrings.end()) {
-        if (!reuse) {
-          static std::vector<std::unique_ptr<std::string>> allocated;
-          allocated.emplace_back(wasm::make_unique<std::string>(s));
-          s = allocated.back()->c_str(); // we'll never modify it, so this is ok
-        }
-        // insert into global set
-        globalStrings.insert(s);
-      } else {
-        s = *globalExisting;
-      }
+      // if the string isn't already known to us, find or add it in the
+      // global table, so each string is allocated exactly once
+      s = Table::intern(s, reuse);
       // add the string to our thread-local set
       strings.insert(s);
     } else {
@@ -836,16 +836,43 @@ struct JSPrinter {
     // try to emit the fewest necessary characters
     bool integer = fmod(d, 1) == 0;
     #define BUFFERSIZE 1000
-    static char full_storage_f[BUFFERSIZE], full_storage_e[BUFFERSIZE]; // f is normal, e is scientific for float, x for integer
-    static char *storage_f = full_storage_f + 1, *storage_e = full_storage_e + 1; // full has one more char, for a possible '-'
+    // per thread, as functions may be printed in parallel
+    thread_local static char full_storage_f[BUFFERSIZE], full_storage_e[BUFFERSIZE]; // f is normal, e is scientific for float, x for integer
+    thread_local static char *storage_f = full_storage_f + 1, *storage_e = full_storage_e + 1; // full has one more char, for a possible '-'
+    if (integer && finalize && wasm::isUInteger64(d)) {
+      // fast path for what the search below ends up with for integers: the
+      // digits, with 3 or more trailing zeros turned into an exponent
+      unsigned long long uu = wasm::toUInteger64(d);
+      char *end = storage_f + 20;
+      char *start = end;
+      do {
+        *--start = '0' + uu % 10;
+        uu /= 10;
+      } while (uu);
+      char *test = end - 1;
+      while (*test == '0' && test > start) test--;
+      int num = end - 1 - test;
+      if (num >= 3) {
+        end = test + 1;
+        *end++ = 'e';
+        if (num >= 10) *end++ = '0' + (num / 10);
+        *end++ = '0' + (num % 10);
+      }
+      *end = 0;
+      if (neg) *--start = '-'; // safe, there is one more char before storage_f
+      return start;
+    }
     auto err_f = std::numeric_limits<double>::quiet_NaN();
     auto err_e = std::numeric_limits<double>::quiet_NaN();
-    for (int e = 0; e <= 1; e++) {
+    // a %f with fewer significant digits than the shortest %e that round-trips
+    // cannot round-trip either, so do %e first, and skip those
+    int minFixed = 0;
+    for (int e = 1; e >= 0; e--) {
       char *buffer = e ? storage_e : storage_f;
       double temp;
       if (!integer) {
-        static char format[6];
-        for (int i = 0; i <= 18; i++) {
+        thread_local static char format[6];
+        for (int i = e ? 0 : minFixed; i <= 18; i++) {
           format[0] = '%';
           format[1] = '.';
           if (i < 10) {
@@ -859,9 +886,15 @@ struct JSPrinter {
             format[5] = 0;
           }
           snprintf(buffer, BUFFERSIZE-1, format, d);
-          sscanf(buffer, "%lf", &temp);
+          temp = strtod(buffer, nullptr);
           //errv("%.18f, %.18e   =>   %s   =>   %.18f, %.18e   (%d), ", d, d, buffer, temp, temp, temp == d);
-          if (temp == d) break;
+          if (temp == d) {
+            if (e) {
+              // the exponent may be one more than d's, if rounding carried
+              minFixed = std::min(std::max(i - atoi(strchr(buffer, 'e') + 1), 0), 18);
+            }
+            break;
+          }
         }
       } else {
         // integer
@@ -875,12 +908,12 @@ struct JSPrinter {
             sscanf(buffer, "%llx", &tempULL);
             temp = (double)tempULL;
           } else {
-            sscanf(buffer, "%lf", &temp);
+            temp = strtod(buffer, nullptr);
           }
         } else {
           // too large for a machine integer, just use floats
           snprintf(buffer, BUFFERSIZE-1, e ? "%e" : "%.0f", d); // even on integers, e with a dot is useful, e.g. 1.2e+200
-          sscanf(buffer, "%lf", &temp);
+          temp = strtod(buffer, nullptr);
         }
         //errv("%.18f, %.18e   =>   %s   =>   %.18f, %.18e, %llu   (%d)\n", d, d, buffer, temp, temp, uu, temp == d);
       }
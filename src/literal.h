@@ -18,6 +18,7 @@
 #define wasm_literal_h
 
 #include <iostream>
+#include "support/text-writer.h"
 #include "support/utilities.h"
 #include "compiler-support.h"
 #include "wasm-type.h"
@@ -82,8 +83,11 @@ private:
 
   static void printFloat(std::ostream &o, float f);
   static void printDouble(std::ostream& o, double d);
+  static void printFloat(TextWriter &o, float f);
+  static void printDouble(TextWriter& o, double d);
 
   friend std::ostream& operator<<(std::ostream& o, Literal literal);
+  friend TextWriter& operator<<(TextWriter& o, Literal literal);
 
   Literal countLeadingZeroes() const;
   Literal countTrailingZeroes() const;
@@ -19,6 +19,7 @@
 
 #include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
 #include <memory>
 #include <mutex>
@@ -52,8 +53,14 @@
 // than that arena's original thread, and will perform the allocation
 // in a side arena for that other thread. This is done in a transparent
 // way to the outside; as a result, it is always safe to allocate using
-// a MixedArena, no matter which thread you are on. Allocations will
-// of course be fastest on the original thread for the arena.
+// a MixedArena, no matter which thread you are on. Each thread remembers
+// which arena it bumps in for the last few arenas it allocated in, so
+// after the first allocation this is as fast as on the original thread.
+//
+// Allocations on an arena can also be redirected, for the current thread
+// only, to another arena. The PassRunner uses this to place everything
+// it allocates while optimizing a function into memory that it can free
+// when it is done with that function (see PassOptions::reclaimMemory).
 //
 
 struct MixedArena {
@@ -64,48 +71,164 @@ struct MixedArena {
 
   std::thread::id threadId;
 
+  // unique over the lifetime of the process, unlike our address
+  uint64_t id;
+
   // multithreaded allocation - each arena is valid on a specific thread.
   // if we are on the wrong thread, we atomically look in the linked
   // list of next, adding an allocator if necessary
   std::atomic<MixedArena*> next;
 
   MixedArena() {
+    static std::atomic<uint64_t> nextId(1);
+    id = nextId++;
     threadId = std::this_thread::get_id();
     next.store(nullptr);
   }
 
+  // While a redirect is in place, allocations on this thread in |from|
+  // are made in |to| instead.
+  struct Redirect {
+    MixedArena* from = nullptr;
+    MixedArena* to = nullptr;
+  };
+
+  // Per-thread state: the current redirect, and a small cache that maps
+  // arenas to the arena this thread actually bumps in for them (the arena
+  // itself on its own thread, or a side arena otherwise). A hit in the
+  // cache skips the thread id check and the walk along next.
+  struct ThreadState {
+    Redirect redirect;
+    static const size_t CacheSize = 4;
+    struct CacheEntry {
+      uint64_t id = 0; // 0 is never an arena's id
+      MixedArena* arena = nullptr;
+    } cache[CacheSize];
+  };
+
+  static ThreadState& getThreadState() {
+    thread_local static ThreadState state;
+    return state;
+  }
+
+  static Redirect& getRedirect() {
+    return getThreadState().redirect;
+  }
+
+  // Redirects allocations for the lifetime of this object.
+  struct ScopedRedirect {
+    Redirect old;
+
+    ScopedRedirect(MixedArena& from, MixedArena& to) {
+      auto& redirect = getRedirect();
+      old = redirect;
+      redirect.from = &from;
+      redirect.to = &to;
+    }
+
+    ~ScopedRedirect() {
+      getRedirect() = old;
+    }
+  };
+
+  // Returns the arena this thread actually allocates in when asked to
+  // allocate in this one.
+  MixedArena* getLocalArena() {
+    auto& state = getThreadState();
+    if (state.redirect.from == this) {
+      return state.redirect.to->getLocalArena();
+    }
+    auto& entry = state.cache[id & (ThreadState::CacheSize - 1)];
+    if (entry.id != id) {
+      entry.arena = getArenaForThisThread();
+      entry.id = id;
+    }
+    return entry.arena;
+  }
+
   void* allocSpace(size_t size) {
-    // the bump allocator data should not be modified by multiple threads at once.
+    return getLocalArena()->bump(size);
+  }
+
+  template<class T>
+  T* alloc() {
+    auto* ret = static_cast<T*>(allocSpace(sizeof(T)));
+    new (ret) T(*this); // allocated objects receive the allocator, so they can allocate more later if necessary
+    return ret;
+  }
+
+  // Recycling. The memory of an object that is no longer referenced from
+  // anywhere can be handed back, filed under a kind (for AST nodes, their
+  // id), and later allocations of the same kind will reuse it. All objects
+  // of a kind must have the same size, at least that of a pointer. Like
+  // allocation, recycled memory is kept per thread.
+
+  std::vector<void*> freeLists; // for each kind, linked through the first word
+
+  void recycle(void* item, size_t kind) {
+    auto& lists = getLocalArena()->freeLists;
+    if (kind >= lists.size()) {
+      lists.resize(kind + 1);
+    }
+    *static_cast<void**>(item) = lists[kind];
+    lists[kind] = item;
+  }
+
+  void* allocSpace(size_t size, size_t kind) {
+    auto* arena = getLocalArena();
+    auto& lists = arena->freeLists;
+    if (kind < lists.size() && lists[kind]) {
+      void* item = lists[kind];
+      lists[kind] = *static_cast<void**>(item);
+      return item;
+    }
+    return arena->bump(size);
+  }
+
+  template<class T>
+  T* alloc(size_t kind) {
+    auto* ret = static_cast<T*>(allocSpace(sizeof(T), kind));
+    new (ret) T(*this);
+    return ret;
+  }
+
+  // Finds the arena in the chain of next that belongs to this thread,
+  // creating it if necessary.
+  MixedArena* getArenaForThisThread() {
     auto myId = std::this_thread::get_id();
-    if (myId != threadId) {
-      MixedArena* curr = this;
-      MixedArena* allocated = nullptr;
-      while (myId != curr->threadId) {
-        auto seen = curr->next.load();
-        if (seen) {
-          curr = seen;
-          continue;
-        }
-        // there is a nullptr for next, so we may be able to place a new
-        // allocator for us there. but carefully, as others may do so as
-        // well. we may waste a few allocations here, but it doesn't matter
-        // as this can only happen as the chain is built up, i.e.,
-        // O(# of cores) per allocator, and our allocatrs are long-lived.
-        if (!allocated) {
-          allocated = new MixedArena(); // has our thread id
-        }
-        if (curr->next.compare_exchange_weak(seen, allocated)) {
-          // we replaced it, so we are the next in the chain
-          // we can forget about allocated, it is owned by the chain now
-          allocated = nullptr;
-          break;
-        }
-        // otherwise, the cmpxchg updated seen, and we continue to loop
+    MixedArena* curr = this;
+    MixedArena* allocated = nullptr;
+    while (myId != curr->threadId) {
+      auto seen = curr->next.load();
+      if (seen) {
         curr = seen;
+        continue;
+      }
+      // there is a nullptr for next, so we may be able to place a new
+      // allocator for us there. but carefully, as others may do so as
+      // well. we may waste a few allocations here, but it doesn't matter
+      // as this can only happen as the chain is built up, i.e.,
+      // O(# of cores) per allocator, and our allocatrs are long-lived.
+      if (!allocated) {
+        allocated = new MixedArena(); // has our thread id
+      }
+      if (curr->next.compare_exchange_weak(seen, allocated)) {
+        // we replaced it, so we are the next in the chain
+        // we can forget about allocated, it is owned by the chain now
+        curr = allocated;
+        allocated = nullptr;
+        break;
       }
-      if (allocated) delete allocated;
-      return curr->allocSpace(size);
+      // otherwise, the cmpxchg updated seen, and we continue to loop
+      curr = seen;
     }
+    if (allocated) delete allocated;
+    return curr;
+  }
+
+  // the bump allocator data should not be modified by multiple threads at
+  // once, so this must only be called on the arena's own thread.
+  void* bump(size_t size) {
     size = (size + 7) & (-8); // same alignment as malloc TODO optimize?
     bool mustAllocate = false;
     while (chunkSize <= size) {
@@ -121,18 +244,13 @@ struct MixedArena {
     return static_cast<void*>(ret);
   }
 
-  template<class T>
-  T* alloc() {
-    auto* ret = static_cast<T*>(allocSpace(sizeof(T)));
-    new (ret) T(*this); // allocated objects receive the allocator, so they can allocate more later if necessary
-    return ret;
-  }
-
   void clear() {
     for (char* chunk : chunks) {
       delete[] chunk;
     }
     chunks.clear();
+    freeLists.clear();
+    if (next.load()) next.load()->clear();
   }
 
   ~MixedArena() {
@@ -18,6 +18,9 @@
 #define wasm_parsing_h
 
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <ostream>
 #include <sstream>
 #include <string>
@@ -76,12 +79,17 @@ struct MapParseException {
   }
 };
 
-inline Expression* parseConst(cashew::IString s, WasmType type, MixedArena& allocator) {
-  const char *str = s.str;
+// Parses an unsigned integer in a constant, clamping it to max on overflow.
+inline uint64_t parseConstInteger(const char* str, int base, uint64_t max) {
+  uint64_t ret = strtoull(str, nullptr, base);
+  return ret > max ? max : ret;
+}
+
+inline Expression* parseConst(const char* str, WasmType type, MixedArena& allocator) {
   auto ret = allocator.alloc<Const>();
   ret->type = type;
   if (isWasmTypeFloat(type)) {
-    if (s == _INFINITY) {
+    if (strcmp(str, _INFINITY.str) == 0) {
       switch (type) {
         case f32: ret->value = Literal(std::numeric_limits<float>::infinity()); break;
         case f64: ret->value = Literal(std::numeric_limits<double>::infinity()); break;
@@ -90,7 +98,7 @@ inline Expression* parseConst(cashew::IString s, WasmType type, MixedArena& allo
       //std::cerr << "make constant " << str << " ==> " << ret->value << '\n';
       return ret;
     }
-    if (s == NEG_INFINITY) {
+    if (strcmp(str, NEG_INFINITY.str) == 0) {
       switch (type) {
         case f32: ret->value = Literal(-std::numeric_limits<float>::infinity()); break;
         case f64: ret->value = Literal(-std::numeric_limits<double>::infinity()); break;
@@ -99,7 +107,7 @@ inline Expression* parseConst(cashew::IString s, WasmType type, MixedArena& allo
       //std::cerr << "make constant " << str << " ==> " << ret->value << '\n';
       return ret;
     }
-    if (s == _NAN) {
+    if (strcmp(str, _NAN.str) == 0) {
       switch (type) {
         case f32: ret->value = Literal(float(std::nan(""))); break;
         case f64: ret->value = Literal(double(std::nan(""))); break;
@@ -154,7 +162,7 @@ inline Expression* parseConst(cashew::IString s, WasmType type, MixedArena& allo
       //std::cerr << "make constant " << str << " ==> " << ret->value << '\n';
       return ret;
     }
-    if (s == NEG_NAN) {
+    if (strcmp(str, NEG_NAN.str) == 0) {
       switch (type) {
         case f32: ret->value = Literal(float(-std::nan(""))); break;
         case f64: ret->value = Literal(double(-std::nan(""))); break;
@@ -169,14 +177,10 @@ inline Expression* parseConst(cashew::IString s, WasmType type, MixedArena& allo
       if ((str[0] == '0' && str[1] == 'x') || (str[0] == '-' && str[1] == '0' && str[2] == 'x')) {
         bool negative = str[0] == '-';
         if (negative) str++;
-        std::istringstream istr(str);
-        uint32_t temp;
-        istr >> std::hex >> temp;
+        uint32_t temp = parseConstInteger(str, 16, std::numeric_limits<uint32_t>::max());
         ret->value = Literal(negative ? -temp : temp);
       } else {
-        std::istringstream istr(str[0] == '-' ? str + 1 : str);
-        uint32_t temp;
-        istr >> temp;
+        uint32_t temp = parseConstInteger(str[0] == '-' ? str + 1 : str, 10, std::numeric_limits<uint32_t>::max());
         ret->value = Literal(str[0] == '-' ? -temp : temp);
       }
       break;
@@ -185,14 +189,10 @@ inline Expression* parseConst(cashew::IString s, WasmType type, MixedArena& allo
       if ((str[0] == '0' && str[1] == 'x') || (str[0] == '-' && str[1] == '0' && str[2] == 'x')) {
         bool negative = str[0] == '-';
         if (negative) str++;
-        std::istringstream istr(str);
-        uint64_t temp;
-        istr >> std::hex >> temp;
+        uint64_t temp = parseConstInteger(str, 16, std::numeric_limits<uint64_t>::max());
         ret->value = Literal(negative ? -temp : temp);
       } else {
-        std::istringstream istr(str[0] == '-' ? str + 1 : str);
-        uint64_t temp;
-        istr >> temp;
+        uint64_t temp = parseConstInteger(str[0] == '-' ? str + 1 : str, 10, std::numeric_limits<uint64_t>::max());
         ret->value = Literal(str[0] == '-' ? -temp : temp);
       }
       break;
@@ -216,6 +216,10 @@ inline Expression* parseConst(cashew::IString s, WasmType type, MixedArena& allo
   return ret;
 }
 
+inline Expression* parseConst(cashew::IString s, WasmType type, MixedArena& allocator) {
+  return parseConst(s.str, type, allocator);
+}
+
 // Helper for parsers that may not have unique label names. This transforms
 // the names into unique ones, as required by Binaryen IR.
 struct UniqueNameMapper {
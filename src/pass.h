@@ -62,6 +62,8 @@ struct PassOptions {
   int shrinkLevel = 0;   // 0, 1, 2 correspond to -O0, -Os, -Oz
   bool ignoreImplicitTraps = false; // optimize assuming things like div by 0, bad load/store, will not trap
   bool debugInfo = false; // whether to try to preserve debug info through, which are special calls
+  bool reclaimMemory = false; // after function-parallel passes, move function bodies to fresh memory and free the rest. only safe if nothing outside the module refers to their expressions
+  std::string cacheDirectory; // if set, cache the results of function-parallel passes on functions in this directory, and reuse them
 };
 
 //
@@ -148,6 +150,18 @@ private:
   void doAdd(Pass* pass);
 
   void runPassOnFunction(Pass* pass, Function* func);
+
+  // Runs a pass that is not function-parallel, decoding any lazy function
+  // bodies first if the pass needs them.
+  void runPassOnModule(Pass* pass);
+
+  // Runs a stack of function-parallel passes on a function, allocating in
+  // scratch, and then moves the function's body into home.
+  void runPassesOnFunctionReclaimingMemory(std::vector<Pass*>& stack, Function* func, MixedArena& scratch, MixedArena& home);
+
+  // After all function bodies were moved into homes, moves the rest of the
+  // module's code as well, and frees the memory it all used before.
+  void reclaimModuleMemory(std::vector<std::unique_ptr<MixedArena>>& homes);
 };
 
 //
@@ -186,6 +200,13 @@ public:
   // function either (which could be very inefficient).
   virtual bool isFunctionParallel() { return false; }
 
+  // Whether the pass can run on a module with functions whose bodies have
+  // not been decoded yet, see Function::isLazy(). Walkers and function-parallel
+  // passes decode the bodies they visit, but a pass that looks at bodies in
+  // other ways must decode them first. Unless this returns true, the
+  // PassRunner decodes all the bodies before running the pass.
+  virtual bool handlesLazyFunctions() { return false; }
+
   // This method is used to create instances per function for a function-parallel
   // pass. You may need to override this if you subclass a Walker, as otherwise
   // this will create the parent class.
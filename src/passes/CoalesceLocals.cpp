@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "wasm.h"
@@ -117,6 +118,191 @@ struct LocalSet : std::vector<Index> {
   }
 };
 
+// Which pairs of locals interfere. With few locals this is a bit matrix,
+// which is quick to fill and query. But that is quadratic in size, while
+// functions with very many locals (asm2wasm can emit tens of thousands) tend
+// to have few interferences, so for those each local instead has a list of
+// the higher locals it interferes with, which is deduplicated as it grows.
+// If the lists get bigger than the matrix would be, and the matrix is not too
+// big, it becomes a matrix after all. Once all interferences are known,
+// finish() turns the lists into sorted lists of all the neighbors of each
+// local.
+struct Interferences {
+  static const Index MaxDense = 1024; // start with a matrix of at most 128K
+  static const Index MaxBecomeDense = 16384; // a 32MB matrix
+
+  Index numLocals = 0;
+  bool dense = true;
+  std::vector<bool> matrix; // (i, j) for i < j, and (j, i) too once finished
+  std::vector<std::vector<Index>> higher; // while adding, if not dense
+  size_t numEntries; // added to those lists, including duplicates
+  size_t maxEntries; // when to become dense instead
+  std::vector<Index> starts, neighbors; // once finished, if not dense
+
+  void reset(Index numLocals_) {
+    numLocals = numLocals_;
+    dense = numLocals <= MaxDense;
+    matrix.clear();
+    higher.clear();
+    starts.clear();
+    neighbors.clear();
+    if (dense) {
+      matrix.resize(numLocals * numLocals);
+    } else {
+      higher.resize(numLocals);
+      numEntries = 0;
+      // an entry takes 32 bits and a matrix 1 bit per pair
+      maxEntries = numLocals <= MaxBecomeDense ? size_t(numLocals) * numLocals / 32 : size_t(-1);
+    }
+  }
+
+  void add(Index low, Index high) {
+    assert(low < high);
+    if (dense) {
+      matrix[low * numLocals + high] = true;
+    } else {
+      addToList(low, high);
+    }
+  }
+
+  void addToList(Index low, Index high) {
+    auto& list = higher[low];
+    if (list.size() == list.capacity() && list.size() >= 16) {
+      // deduplicate rather than grow, unless that frees too little
+      sortAndDeduplicate(list);
+      if (list.size() * 2 > list.capacity()) list.reserve(list.capacity() * 2);
+    }
+    list.push_back(high);
+    if (++numEntries > maxEntries) becomeDense();
+  }
+
+  void becomeDense() {
+    dense = true;
+    matrix.resize(numLocals * numLocals);
+    for (Index i = 0; i < numLocals; i++) {
+      for (auto j : higher[i]) {
+        matrix[i * numLocals + j] = true;
+      }
+    }
+    std::vector<std::vector<Index>>().swap(higher);
+  }
+
+  void finish() {
+    if (dense) {
+      for (Index i = 0; i < numLocals; i++) {
+        for (Index j = i + 1; j < numLocals; j++) {
+          if (matrix[i * numLocals + j]) matrix[j * numLocals + i] = true;
+        }
+      }
+      return;
+    }
+    starts.resize(numLocals + 1);
+    std::fill(starts.begin(), starts.end(), 0);
+    for (Index i = 0; i < numLocals; i++) {
+      sortAndDeduplicate(higher[i]);
+      for (auto j : higher[i]) {
+        starts[i + 1]++;
+        starts[j + 1]++;
+      }
+    }
+    for (Index i = 0; i < numLocals; i++) {
+      starts[i + 1] += starts[i];
+    }
+    // going through the locals in order leaves each list sorted
+    neighbors.resize(starts[numLocals]);
+    std::vector<Index> next(starts.begin(), starts.end() - 1);
+    for (Index i = 0; i < numLocals; i++) {
+      for (auto j : higher[i]) {
+        neighbors[next[i]++] = j;
+        neighbors[next[j]++] = i;
+      }
+    }
+    std::vector<std::vector<Index>>().swap(higher);
+  }
+
+  bool has(Index i, Index j) {
+    if (dense) return matrix[i * numLocals + j];
+    return std::binary_search(neighbors.begin() + starts[i], neighbors.begin() + starts[i + 1], j);
+  }
+
+  // Calls func(j) for each local j interfering with i, in order.
+  template<typename F>
+  void forEachNeighbor(Index i, F func) {
+    if (dense) {
+      auto row = matrix.begin() + i * numLocals;
+      for (Index j = 0; j < numLocals; j++) {
+        if (row[j]) func(j);
+      }
+    } else {
+      for (Index k = starts[i]; k < starts[i + 1]; k++) {
+        func(neighbors[k]);
+      }
+    }
+  }
+
+private:
+  static void sortAndDeduplicate(std::vector<Index>& list) {
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+  }
+};
+
+// How many copies there are between pairs of locals, saturating at 255. There
+// are no more pairs with copies than there are sets, so only those are kept.
+// Once all copies are known, finish() gives each local a list of the locals
+// it has copies with.
+struct Copies {
+  std::unordered_map<uint64_t, uint8_t> counts;
+  std::vector<Index> starts;
+  std::vector<std::pair<Index, uint8_t>> partners;
+
+  static uint64_t key(Index i, Index j) {
+    return (uint64_t(std::min(i, j)) << 32) | std::max(i, j);
+  }
+
+  void clear() {
+    counts.clear();
+  }
+
+  void add(Index i, Index j) {
+    auto& count = counts[key(i, j)];
+    count = std::min(count, uint8_t(254)) + 1;
+  }
+
+  uint8_t get(Index i, Index j) {
+    auto iter = counts.find(key(i, j));
+    return iter != counts.end() ? iter->second : 0;
+  }
+
+  void finish(Index numLocals) {
+    starts.resize(numLocals + 1);
+    std::fill(starts.begin(), starts.end(), 0);
+    for (auto& pair : counts) {
+      Index low = pair.first >> 32, high = Index(pair.first);
+      starts[low + 1]++;
+      if (high != low) starts[high + 1]++;
+    }
+    for (Index i = 0; i < numLocals; i++) {
+      starts[i + 1] += starts[i];
+    }
+    partners.resize(starts[numLocals]);
+    std::vector<Index> next(starts.begin(), starts.end() - 1);
+    for (auto& pair : counts) {
+      Index low = pair.first >> 32, high = Index(pair.first);
+      partners[next[low]++] = std::make_pair(high, pair.second);
+      if (high != low) partners[next[high]++] = std::make_pair(low, pair.second);
+    }
+  }
+
+  // Calls func(j, count) for each local j that i has copies with.
+  template<typename F>
+  void forEachPartner(Index i, F func) {
+    for (Index k = starts[i]; k < starts[i + 1]; k++) {
+      func(partners[k].first, partners[k].second);
+    }
+  }
+};
+
 // a liveness-relevant action
 struct Action {
   enum What {
@@ -230,44 +416,41 @@ struct CoalesceLocals : public WalkerPass<CFGWalker<CoalesceLocals, Visitor<Coal
 
   // interference state
 
-  std::vector<bool> interferences; // canonicalized - accesses should check (low, high)
+  Interferences interferences;
   std::unordered_set<BasicBlock*> liveBlocks;
 
   void interfere(Index i, Index j) {
     if (i == j) return;
-    interferences[std::min(i, j) * numLocals + std::max(i, j)] = 1;
+    interferences.add(std::min(i, j), std::max(i, j));
   }
 
   void interfereLowHigh(Index low, Index high) { // optimized version where you know that low < high
-    assert(low < high);
-    interferences[low * numLocals + high] = 1;
+    interferences.add(low, high);
   }
 
   bool interferes(Index i, Index j) {
-    return interferences[std::min(i, j) * numLocals + std::max(i, j)];
+    return interferences.has(i, j);
   }
 
   // copying state
 
-  std::vector<uint8_t> copies; // canonicalized - accesses should check (low, high) TODO: use a map for high N, as this tends to be sparse? or don't look at copies at all for big N?
+  Copies copies;
   std::vector<Index> totalCopies; // total # of copies for each local, with all others
 
   void addCopy(Index i, Index j) {
-    auto k = std::min(i, j) * numLocals + std::max(i, j);
-    copies[k] = std::min(copies[k], uint8_t(254)) + 1;
+    copies.add(i, j);
     totalCopies[i]++;
     totalCopies[j]++;
   }
 
   uint8_t getCopies(Index i, Index j) {
-    return copies[std::min(i, j) * numLocals + std::max(i, j)];
+    return copies.get(i, j);
   }
 };
 
 void CoalesceLocals::doWalkFunction(Function* func) {
   numLocals = func->getNumLocals();
-  copies.resize(numLocals * numLocals);
-  std::fill(copies.begin(), copies.end(), 0);
+  copies.clear();
   totalCopies.resize(numLocals);
   std::fill(totalCopies.begin(), totalCopies.end(), 0);
   // collect initial liveness info
@@ -292,6 +475,7 @@ void CoalesceLocals::doWalkFunction(Function* func) {
 #endif
   // use liveness to find interference
   calculateInterferences();
+  copies.finish(numLocals);
   // pick new indices
   std::vector<Index> indices;
   pickIndices(indices);
@@ -322,8 +506,7 @@ void CoalesceLocals::increaseBackEdgePriorities() {
 }
 
 void CoalesceLocals::flowLiveness() {
-  interferences.resize(numLocals * numLocals);
-  std::fill(interferences.begin(), interferences.end(), 0);
+  interferences.reset(numLocals);
   // keep working while stuff is flowing
   std::unordered_set<BasicBlock*> queue;
   for (auto& curr : basicBlocks) {
@@ -357,17 +540,6 @@ void CoalesceLocals::flowLiveness() {
       queue.insert(in);
     }
   }
-#ifdef CFG_DEBUG
-  std::hash<std::vector<bool>> hasher;
-  std::cout << getFunction()->name << ": interference hash: " << hasher(*(std::vector<bool>*)&interferences) << "\n";
-  for (Index i = 0; i < numLocals; i++) {
-    std::cout << "int for " << getFunction()->getLocalName(i) << " [" << i << "]: ";
-    for (Index j = 0; j < numLocals; j++) {
-      if (interferes(i, j)) std::cout << getFunction()->getLocalName(j) << " ";
-    }
-    std::cout << "\n";
-  }
-#endif
 }
 
 // merge starts of a list of blocks. return
@@ -428,6 +600,16 @@ void CoalesceLocals::calculateInterferences() {
     start.insert(i);
   }
   calculateInterferences(start);
+  interferences.finish();
+#ifdef CFG_DEBUG
+  for (Index i = 0; i < numLocals; i++) {
+    std::cout << "int for " << getFunction()->getLocalName(i) << " [" << i << "]: ";
+    interferences.forEachNeighbor(i, [&](Index j) {
+      std::cout << getFunction()->getLocalName(j) << " ";
+    });
+    std::cout << "\n";
+  }
+#endif
 }
 
 void CoalesceLocals::calculateInterferences(const LocalSet& locals) {
@@ -480,63 +662,90 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order, std::vector
   }
 #endif
   // TODO: take into account distribution (99-1 is better than 50-50 with two registers, for gzip)
-  std::vector<WasmType> types;
-  std::vector<bool> newInterferences; // new index * numLocals => list of all interferences of locals merged to it
-  std::vector<uint8_t> newCopies; // new index * numLocals => list of all copies of locals merged to it
+  // Each local goes to the first new index of its type that none of the locals already there
+  // interfere with, unless another one has more copies with them. Those are found through the
+  // interferences and copies of the local, so there is no need to look at all pairs of locals
+  // and new indices.
+  struct NewIndex {
+    WasmType type;
+    Index nextOfType; // the next new index of the same type
+    Index interferingWith; // the last local that locals here interfere with
+    Index copyingWith; // the last local that locals here have copies with
+    uint8_t copies; // how many copies those were
+    NewIndex(WasmType type) : type(type), nextOfType(-1), interferingWith(-1), copyingWith(-1), copies(0) {}
+  };
+  std::vector<NewIndex> newIndices;
+  Index firstOfType[unreachable + 1], lastOfType[unreachable + 1];
+  std::fill(firstOfType, firstOfType + unreachable + 1, Index(-1));
+  auto addNewIndex = [&](WasmType type) {
+    Index index = newIndices.size();
+    newIndices.emplace_back(type);
+    if (firstOfType[type] == Index(-1)) {
+      firstOfType[type] = index;
+    } else {
+      newIndices[lastOfType[type]].nextOfType = index;
+    }
+    lastOfType[type] = index;
+    return index;
+  };
+  std::vector<Index> copying; // the new indices with copies with the current local
+  newIndices.reserve(numLocals);
   indices.resize(numLocals);
-  types.resize(numLocals);
-  newInterferences.resize(numLocals * numLocals);
-  std::fill(newInterferences.begin(), newInterferences.end(), 0);
+  std::fill(indices.begin(), indices.end(), Index(-1)); // not picked yet
   auto numParams = getFunction()->getNumParams();
-  newCopies.resize(numParams * numLocals); // start with enough room for the params
-  std::fill(newCopies.begin(), newCopies.end(), 0);
-  Index nextFree = 0;
   removedCopies = 0;
   // we can't reorder parameters, they are fixed in order, and cannot coalesce
   Index i = 0;
   for (; i < numParams; i++) {
     assert(order[i] == i); // order must leave the params in place
-    indices[i] = i;
-    types[i] = getFunction()->getLocalType(i);
-    for (Index j = numParams; j < numLocals; j++) {
-      newInterferences[numLocals * i + j] = interferes(i, j);
-      newCopies[numLocals * i + j] = getCopies(i, j);
-    }
-    nextFree++;
+    indices[i] = addNewIndex(getFunction()->getLocalType(i));
   }
   for (; i < numLocals; i++) {
     Index actual = order[i];
+    auto type = getFunction()->getLocalType(actual);
+    interferences.forEachNeighbor(actual, [&](Index j) {
+      if (indices[j] != Index(-1)) newIndices[indices[j]].interferingWith = actual;
+    });
+    copying.clear();
+    copies.forEachPartner(actual, [&](Index j, uint8_t count) {
+      if (indices[j] == Index(-1)) return;
+      auto& newIndex = newIndices[indices[j]];
+      if (newIndex.copyingWith != actual) {
+        newIndex.copyingWith = actual;
+        newIndex.copies = 0;
+        copying.push_back(indices[j]);
+      }
+      newIndex.copies += count;
+    });
+    // pick the one eliminating the most copies, or else the first
     Index found = -1;
-    uint8_t foundCopies = -1;
-    for (Index j = 0; j < nextFree; j++) {
-      if (!newInterferences[j * numLocals + actual] && getFunction()->getLocalType(actual) == types[j]) {
-        // this does not interfere, so it might be what we want. but pick the one eliminating the most copies
-        // (we could stop looking forward when there are no more items that have copies anyhow, but it doesn't seem to help)
-        auto currCopies = newCopies[j * numLocals + actual];
-        if (found == Index(-1) || currCopies > foundCopies) {
-          indices[actual] = found = j;
-          foundCopies = currCopies;
+    uint8_t foundCopies = 0;
+    for (auto j : copying) {
+      auto& newIndex = newIndices[j];
+      if (newIndex.interferingWith == actual || newIndex.type != type) continue;
+      if (newIndex.copies > foundCopies || (newIndex.copies > 0 && newIndex.copies == foundCopies && j < found)) {
+        found = j;
+        foundCopies = newIndex.copies;
+      }
+    }
+    if (found == Index(-1)) {
+      for (Index j = firstOfType[type]; j != Index(-1); j = newIndices[j].nextOfType) {
+        if (newIndices[j].interferingWith != actual) {
+          found = j;
+          break;
         }
       }
     }
     if (found == Index(-1)) {
-      indices[actual] = found = nextFree;
-      types[found] = getFunction()->getLocalType(actual);
-      nextFree++;
+      found = addNewIndex(type);
       removedCopies += getCopies(found, actual);
-      newCopies.resize(nextFree * numLocals);
     } else {
       removedCopies += foundCopies;
     }
+    indices[actual] = found;
 #if CFG_DEBUG
     std::cerr << "set local $" << actual << " to $" << found << '\n';
 #endif
-    // merge new interferences and copies for the new index
-    for (Index k = i + 1; k < numLocals; k++) {
-      auto j = order[k]; // go in the order, we only need to update for those we will see later
-      newInterferences[found * numLocals + j] = newInterferences[found * numLocals + j] | interferes(actual, j);
-      newCopies[found * numLocals + j] += getCopies(actual, j);
-    }
   }
 }
 
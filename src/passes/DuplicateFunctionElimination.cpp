@@ -30,7 +30,7 @@ namespace wasm {
 struct FunctionHasher : public WalkerPass<PostWalker<FunctionHasher>> {
   bool isFunctionParallel() override { return true; }
 
-  FunctionHasher(std::map<Function*, uint32_t>* output) : output(output) {}
+  FunctionHasher(std::unordered_map<Function*, uint32_t>* output) : output(output) {}
 
   FunctionHasher* create() override {
     return new FunctionHasher(output);
@@ -49,7 +49,7 @@ struct FunctionHasher : public WalkerPass<PostWalker<FunctionHasher>> {
   }
 
 private:
-  std::map<Function*, uint32_t>* output;
+  std::unordered_map<Function*, uint32_t>* output;
   uint32_t digest = 0;
 
   void hash(uint32_t hash) {
@@ -63,7 +63,7 @@ private:
 struct FunctionReplacer : public WalkerPass<PostWalker<FunctionReplacer>> {
   bool isFunctionParallel() override { return true; }
 
-  FunctionReplacer(std::map<Name, Name>* replacements) : replacements(replacements) {}
+  FunctionReplacer(std::unordered_map<Name, Name>* replacements) : replacements(replacements) {}
 
   FunctionReplacer* create() override {
     return new FunctionReplacer(replacements);
@@ -77,7 +77,7 @@ struct FunctionReplacer : public WalkerPass<PostWalker<FunctionReplacer>> {
   }
 
 private:
-  std::map<Name, Name>* replacements;
+  std::unordered_map<Name, Name>* replacements;
 };
 
 struct DuplicateFunctionElimination : public Pass {
@@ -98,8 +98,8 @@ struct DuplicateFunctionElimination : public Pass {
         hashGroups[hashes[func.get()]].push_back(func.get());
       }
       // Find actually equal functions and prepare to replace them
-      std::map<Name, Name> replacements;
-      std::set<Name> duplicates;
+      std::unordered_map<Name, Name> replacements;
+      std::unordered_set<Name> duplicates;
       for (auto& pair : hashGroups) {
         auto& group = pair.second;
         if (group.size() == 1) continue;
@@ -165,7 +165,7 @@ struct DuplicateFunctionElimination : public Pass {
   }
 
 private:
-  std::map<Function*, uint32_t> hashes;
+  std::unordered_map<Function*, uint32_t> hashes;
 
   bool equal(Function* left, Function* right) {
     if (left->getNumParams() != right->getNumParams()) return false;
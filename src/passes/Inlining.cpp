@@ -22,6 +22,8 @@
 // speed benefits.
 //
 
+#include <atomic>
+
 #include <wasm.h>
 #include <pass.h>
 #include <wasm-builder.h>
@@ -29,21 +31,24 @@
 
 namespace wasm {
 
-struct FunctionUseCounter : public WalkerPass<PostWalker<FunctionUseCounter>> {
-  bool isFunctionParallel() override { return true; }
+// Functions are referred to by their dense index in module->functions,
+// so the bookkeeping below is in flat vectors and not maps on names.
 
-  FunctionUseCounter(std::map<Name, Index>* output) : output(output) {}
+struct FunctionIds {
+  std::unordered_map<Name, Index> ids;
 
-  FunctionUseCounter* create() override {
-    return new FunctionUseCounter(output);
+  FunctionIds(Module* module) {
+    for (Index i = 0; i < module->functions.size(); i++) {
+      ids[module->functions[i]->name] = i;
+    }
   }
 
-  void visitCall(Call *curr) {
-    (*output)[curr->target]++;
+  // returns the index of a defined function, or -1 if not defined here
+  Index get(Name name) {
+    auto iter = ids.find(name);
+    if (iter == ids.end()) return Index(-1);
+    return iter->second;
   }
-
-private:
-  std::map<Name, Index>* output;
 };
 
 struct Action {
@@ -55,8 +60,35 @@ struct Action {
 };
 
 struct InliningState {
-  std::set<Name> canInline;
-  std::map<Name, std::vector<Action>> actionsForFunction; // function name => actions that can be performed in it
+  FunctionIds ids;
+  // function index => number of uses. calls from different functions can
+  // be to the same target, so these are updated atomically
+  std::vector<std::atomic<Index>> uses;
+  std::vector<bool> canInline; // function index => whether to inline it
+  std::vector<std::vector<Action>> actionsForFunction; // function index => actions that can be performed in it
+
+  InliningState(Module* module) : ids(module), uses(module->functions.size()) {
+    for (auto& use : uses) {
+      use.store(0);
+    }
+  }
+};
+
+struct FunctionUseCounter : public WalkerPass<PostWalker<FunctionUseCounter>> {
+  bool isFunctionParallel() override { return true; }
+
+  FunctionUseCounter(InliningState* state) : state(state) {}
+
+  FunctionUseCounter* create() override {
+    return new FunctionUseCounter(state);
+  }
+
+  void visitCall(Call *curr) {
+    state->uses[state->ids.get(curr->target)]++;
+  }
+
+private:
+  InliningState* state;
 };
 
 struct Planner : public WalkerPass<PostWalker<Planner>> {
@@ -69,24 +101,27 @@ struct Planner : public WalkerPass<PostWalker<Planner>> {
   }
 
   void visitCall(Call *curr) {
-    if (state->canInline.count(curr->target)) {
+    auto target = state->ids.get(curr->target);
+    if (state->canInline[target]) {
       auto* block = Builder(*getModule()).makeBlock();
       block->type = curr->type;
       replaceCurrent(block);
-      state->actionsForFunction[getFunction()->name].emplace_back(curr, block, getModule()->getFunction(curr->target));
+      state->actionsForFunction[index].emplace_back(curr, block, getModule()->functions[target].get());
     }
   }
 
   void doWalkFunction(Function* func) {
+    index = state->ids.get(func->name);
     // we shouldn't inline into us if we are to be inlined
     // ourselves - that has the risk of cycles
-    if (state->canInline.count(func->name) == 0) {
+    if (!state->canInline[index]) {
       walk(func->body);
     }
   }
 
 private:
   InliningState* state;
+  Index index;
 };
 
 // Core inlining logic. Modifies the outside function (adding locals as
@@ -137,39 +172,39 @@ struct Inlining : public Pass {
   }
 
   bool iteration(PassRunner* runner, Module* module) {
+    InliningState state(module);
+    auto numFunctions = module->functions.size();
     // Count uses
-    std::map<Name, Index> uses;
-    // fill in uses, as we operate on it in parallel (each function to its own entry)
-    for (auto& func : module->functions) {
-      uses[func->name] = 0;
-    }
+    auto& uses = state.uses;
     {
       PassRunner runner(module);
       runner.setIsNested(true);
-      runner.add<FunctionUseCounter>(&uses);
+      runner.add<FunctionUseCounter>(&state);
       runner.run();
     }
     for (auto& ex : module->exports) {
       if (ex->kind == ExternalKind::Function) {
-        uses[ex->value] = 2; // too many, so we ignore it
+        auto id = state.ids.get(ex->value);
+        if (id != Index(-1)) {
+          uses[id] = 2; // too many, so we ignore it
+        }
       }
     }
     for (auto& segment : module->table.segments) {
       for (auto name : segment.data) {
-        uses[name]++;
+        auto id = state.ids.get(name);
+        if (id != Index(-1)) {
+          uses[id]++;
+        }
       }
     }
     // decide which to inline
-    InliningState state;
-    for (auto iter : uses) {
-      if (iter.second == 1) {
-        state.canInline.insert(iter.first);
-      }
+    state.canInline.resize(numFunctions);
+    for (Index i = 0; i < numFunctions; i++) {
+      state.canInline[i] = uses[i] == 1;
     }
     // fill in actionsForFunction, as we operate on it in parallel (each function to its own entry)
-    for (auto& func : module->functions) {
-      state.actionsForFunction[func->name];
-    }
+    state.actionsForFunction.resize(numFunctions);
     // find and plan inlinings
     {
       PassRunner runner(module);
@@ -178,13 +213,19 @@ struct Inlining : public Pass {
       runner.run();
     }
     // perform inlinings
-    std::set<Name> inlined;
-    std::set<Function*> inlinedInto;
-    for (auto& func : module->functions) {
-      for (auto& action : state.actionsForFunction[func->name]) {
-        doInlining(module, func.get(), action);
-        inlined.insert(action.contents->name);
-        inlinedInto.insert(func.get());
+    std::vector<bool> inlined(numFunctions);
+    std::vector<Function*> inlinedInto;
+    bool inlinedAny = false;
+    for (Index i = 0; i < numFunctions; i++) {
+      auto* func = module->functions[i].get();
+      auto& actions = state.actionsForFunction[i];
+      for (auto& action : actions) {
+        doInlining(module, func, action);
+        inlined[state.ids.get(action.contents->name)] = true;
+        inlinedAny = true;
+      }
+      if (!actions.empty()) {
+        inlinedInto.push_back(func);
       }
     }
     // anything we inlined into may now have non-unique label names, fix it up
@@ -193,11 +234,12 @@ struct Inlining : public Pass {
     }
     // remove functions that we managed to inline, their one use is gone
     auto& funcs = module->functions;
-    funcs.erase(std::remove_if(funcs.begin(), funcs.end(), [&inlined](const std::unique_ptr<Function>& curr) {
-      return inlined.count(curr->name) > 0;
+    funcs.erase(std::remove_if(funcs.begin(), funcs.end(), [&](const std::unique_ptr<Function>& curr) {
+      return inlined[state.ids.get(curr->name)];
     }), funcs.end());
+    module->updateMaps();
     // return whether we did any work
-    return inlined.size() > 0;
+    return inlinedAny;
   }
 };
 
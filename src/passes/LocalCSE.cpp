@@ -47,7 +47,7 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
     Index index; // if not UNUSED, then the local we are assigned to, use that to reuse us
     EffectAnalyzer effects;
 
-    UsableInfo(Expression** item, PassOptions& passOptions) : item(item), index(UNUSED), effects(passOptions, *item) {}
+    UsableInfo(Expression** item, const EffectAnalyzer& effects) : item(item), index(UNUSED), effects(effects) {}
   };
 
   // a list of usables in a linear execution trace
@@ -56,6 +56,16 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
   // locals in current linear execution trace, which we try to sink
   Usables usables;
 
+  // we look at the effects of each expression, and so of its children
+  // again and again
+  std::unique_ptr<EffectCache> effectCache;
+
+  void doWalkFunction(Function* func) {
+    effectCache = make_unique<EffectCache>(getPassOptions());
+    walk(func->body);
+    effectCache.reset();
+  }
+
   static void doNoteNonLinear(LocalCSE* self, Expression** currp) {
     self->usables.clear();
   }
@@ -121,7 +131,7 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
     if (!isConcreteWasmType(curr->type)) {
       return false; // don't bother with unreachable etc.
     }
-    if (EffectAnalyzer(getPassOptions(), curr).hasSideEffects()) {
+    if (effectCache->get(curr).hasSideEffects()) {
       return false; // we can't combine things with side effects
     }
     // check what we care about TODO: use optimize/shrink levels?
@@ -134,6 +144,8 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
     if (iter != usables.end()) {
       // already exists in the table, this is good to reuse
       auto& info = iter->second;
+      // we modify code that cached effects may contain
+      effectCache->clear();
       if (info.index == UNUSED) {
         // we need to assign to a local. create a new one
         auto index = info.index = Builder::addVar(getFunction(), curr->type);
@@ -144,7 +156,7 @@ struct LocalCSE : public WalkerPass<LinearExecutionWalker<LocalCSE>> {
       );
     } else {
       // not in table, add this, maybe we can help others later
-      usables.emplace(std::make_pair(hashed, UsableInfo(currp, getPassOptions())));
+      usables.emplace(std::make_pair(hashed, UsableInfo(currp, effectCache->get(curr))));
     }
   }
 };
@@ -150,12 +150,13 @@ struct BreakValueDropper : public ControlFlowWalker<BreakValueDropper> {
     // likewise, unreachable does not need to be dropped, so we just leave drops of concrete values
     if (!isConcreteWasmType(curr->value->type)) {
       replaceCurrent(curr->value);
+      ExpressionManipulator::recycle(curr, *getModule(), getFunction());
     }
   }
 };
 
-// core block optimizer routine
-static void optimizeBlock(Block* curr, Module* module, PassOptions& passOptions) {
+// core block optimizer routine, returns whether it changed anything
+static bool optimizeBlock(Block* curr, Module* module, Function* func, PassOptions& passOptions) {
   bool more = true;
   bool changed = false;
   while (more) {
@@ -181,6 +182,7 @@ static void optimizeBlock(Block* curr, Module* module, PassOptions& passOptions)
                 BreakValueDropper fixer(passOptions);
                 fixer.origin = child->name;
                 fixer.setModule(module);
+                fixer.setFunction(func);
                 fixer.walk(expression);
               }
             }
@@ -220,16 +222,19 @@ static void optimizeBlock(Block* curr, Module* module, PassOptions& passOptions)
         merged.push_back(curr->list[j]);
       }
       curr->list.swap(merged);
+      // the child block itself is gone now
+      ExpressionManipulator::recycle(child, *module, func);
       more = true;
       changed = true;
       break;
     }
   }
   if (changed) curr->finalize(curr->type);
+  return changed;
 }
 
 void BreakValueDropper::visitBlock(Block* curr) {
-  optimizeBlock(curr, getModule(), passOptions);
+  optimizeBlock(curr, getModule(), getFunction(), passOptions);
 }
 
 struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
@@ -237,20 +242,33 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
 
   Pass* create() override { return new MergeBlocks; }
 
+  // we look at the effects of each child of each node, and of what it must be
+  // reordered through, so in nested code we look at the same code many times
+  std::unique_ptr<EffectCache> effectCache;
+
+  void doWalkFunction(Function* func) {
+    effectCache = make_unique<EffectCache>(getPassOptions());
+    walk(func->body);
+    effectCache.reset();
+  }
+
   void visitBlock(Block *curr) {
-    optimizeBlock(curr, getModule(), getPassOptions());
+    if (optimizeBlock(curr, getModule(), getFunction(), getPassOptions())) {
+      effectCache->clear();
+    }
   }
 
   Block* optimize(Expression* curr, Expression*& child, Block* outer = nullptr, Expression** dependency1 = nullptr, Expression** dependency2 = nullptr) {
     if (!child) return outer;
     if ((dependency1 && *dependency1) || (dependency2 && *dependency2)) {
       // there are dependencies, things we must be reordered through. make sure no problems there
-      EffectAnalyzer childEffects(getPassOptions(), child);
-      if (dependency1 && *dependency1 && EffectAnalyzer(getPassOptions(), *dependency1).invalidates(childEffects)) return outer;
-      if (dependency2 && *dependency2 && EffectAnalyzer(getPassOptions(), *dependency2).invalidates(childEffects)) return outer;
+      auto childEffects = effectCache->get(child);
+      if (dependency1 && *dependency1 && effectCache->get(*dependency1).invalidates(childEffects)) return outer;
+      if (dependency2 && *dependency2 && effectCache->get(*dependency2).invalidates(childEffects)) return outer;
     }
     if (auto* block = child->dynCast<Block>()) {
       if (!block->name.is() && block->list.size() >= 2) {
+        effectCache->clear();
         child = block->list.back();
         // we modified child (which is a reference to a pointer), which modifies curr, which might change its type
         // (e.g. (drop (block (result i32) .. (unreachable)))
@@ -273,6 +291,7 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
             outer->list.push_back(block->list[i]);
           }
           outer->list.push_back(curr);
+          ExpressionManipulator::recycle(block, *getModule(), getFunction());
         }
       }
     }
@@ -306,11 +325,11 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
     // TODO: for now, just stop when we see any side effect. instead, we could
     //       check effects carefully for reordering
     Block* outer = nullptr;
-    if (EffectAnalyzer(getPassOptions(), first).hasSideEffects()) return;
+    if (effectCache->get(first).hasSideEffects()) return;
     outer = optimize(curr, first, outer);
-    if (EffectAnalyzer(getPassOptions(), second).hasSideEffects()) return;
+    if (effectCache->get(second).hasSideEffects()) return;
     outer = optimize(curr, second, outer);
-    if (EffectAnalyzer(getPassOptions(), third).hasSideEffects()) return;
+    if (effectCache->get(third).hasSideEffects()) return;
     optimize(curr, third, outer);
   }
   void visitAtomicCmpxchg(AtomicCmpxchg* curr) {
@@ -336,7 +355,7 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
   void handleCall(T* curr) {
     Block* outer = nullptr;
     for (Index i = 0; i < curr->operands.size(); i++) {
-      if (EffectAnalyzer(getPassOptions(), curr->operands[i]).hasSideEffects()) return;
+      if (effectCache->get(curr->operands[i]).hasSideEffects()) return;
       outer = optimize(curr, curr->operands[i], outer);
     }
     return;
@@ -353,10 +372,10 @@ struct MergeBlocks : public WalkerPass<PostWalker<MergeBlocks>> {
   void visitCallIndirect(CallIndirect* curr) {
     Block* outer = nullptr;
     for (Index i = 0; i < curr->operands.size(); i++) {
-      if (EffectAnalyzer(getPassOptions(), curr->operands[i]).hasSideEffects()) return;
+      if (effectCache->get(curr->operands[i]).hasSideEffects()) return;
       outer = optimize(curr, curr->operands[i], outer);
     }
-    if (EffectAnalyzer(getPassOptions(), curr->target).hasSideEffects()) return;
+    if (effectCache->get(curr->target).hasSideEffects()) return;
     optimize(curr, curr->target, outer);
   }
 };
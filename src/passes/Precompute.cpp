@@ -18,6 +18,8 @@
 // Computes code at compile time where possible.
 //
 
+#include <unordered_set>
+
 #include <wasm.h>
 #include <pass.h>
 #include <wasm-builder.h>
@@ -29,10 +31,28 @@ namespace wasm {
 
 static const Name NONSTANDALONE_FLOW("Binaryen|nonstandalone");
 
-// Execute an expression by itself. Errors if we hit anything we need anything not in the expression itself standalone.
+// Execute an expression by itself. Anything that needs something not in the
+// expression itself, or that traps, gives a flow breaking to
+// NONSTANDALONE_FLOW.
 class StandaloneExpressionRunner : public ExpressionRunner<StandaloneExpressionRunner> {
+  // expressions already known not to be standalone
+  std::unordered_set<Expression*>& nonstandalone;
+
 public:
-  struct NonstandaloneException {}; // TODO: use a flow with a special name, as this is likely very slow
+  StandaloneExpressionRunner(std::unordered_set<Expression*>& nonstandalone) : nonstandalone(nonstandalone) {}
+
+  // how many expressions were evaluated
+  Index evaluated = 0;
+
+  Flow evaluate(Expression* curr) {
+    evaluated++;
+    // running an expression has the same outcome wherever it is, so there is
+    // no need to run into what failed before
+    if (!nonstandalone.empty() && nonstandalone.count(curr)) {
+      return Flow(NONSTANDALONE_FLOW);
+    }
+    return ExpressionRunner<StandaloneExpressionRunner>::evaluate(curr);
+  }
 
   Flow visitLoop(Loop* curr) {
     // loops might be infinite, so must be careful
@@ -77,27 +97,37 @@ public:
     return Flow(NONSTANDALONE_FLOW);
   }
 
-  void trap(const char* why) override {
-    throw NonstandaloneException();
+  Flow trap(const char* why) override {
+    return Flow(NONSTANDALONE_FLOW);
   }
 };
 
+// Expressions are visited bottom-up, so by the time one is run, its children
+// are either constants and other precomputed results, or known not to be
+// standalone. Each run thus only looks at the expression and its children,
+// and the whole pass is linear. Failing again is quick for small expressions,
+// so only bigger ones are remembered.
 struct Precompute : public WalkerPass<PostWalker<Precompute, UnifiedExpressionVisitor<Precompute>>> {
   bool isFunctionParallel() override { return true; }
 
   Pass* create() override { return new Precompute; }
 
+  std::unordered_set<Expression*> nonstandalone;
+
+  static const Index MinNonstandalone = 8;
+
   void visitExpression(Expression* curr) {
     if (curr->is<Const>() || curr->is<Nop>()) return;
     // try to evaluate this into a const
-    Flow flow;
-    try {
-      flow = StandaloneExpressionRunner().visit(curr);
-    } catch (StandaloneExpressionRunner::NonstandaloneException& e) {
-      return;
-    }
+    StandaloneExpressionRunner runner(nonstandalone);
+    Flow flow = runner.visit(curr);
     if (flow.breaking()) {
-      if (flow.breakTo == NONSTANDALONE_FLOW) return;
+      if (flow.breakTo == NONSTANDALONE_FLOW) {
+        if (runner.evaluated >= MinNonstandalone) {
+          nonstandalone.insert(curr);
+        }
+        return;
+      }
       if (flow.breakTo == RETURN_FLOW) {
         // this expression causes a return. if it's already a return, reuse the node
         if (auto* ret = curr->dynCast<Return>()) {
@@ -154,6 +184,7 @@ struct Precompute : public WalkerPass<PostWalker<Precompute, UnifiedExpressionVi
   }
 
   void visitFunction(Function* curr) {
+    nonstandalone.clear();
     // removing breaks can alter types
     ReFinalize().walkFunctionInModule(curr, getModule());
   }
@@ -22,6 +22,9 @@
 #include <wasm-printing.h>
 #include <pass.h>
 #include <pretty_printing.h>
+#include <ast_utils.h>
+#include <support/text-writer.h>
+#include <support/threads.h>
 
 namespace wasm {
 
@@ -33,7 +36,7 @@ static int isFullForced() {
 }
 
 struct PrintSExpression : public Visitor<PrintSExpression> {
-  std::ostream& o;
+  TextWriter& o;
   unsigned indent = 0;
 
   bool minify;
@@ -47,7 +50,7 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
   Function* currFunction = nullptr;
   Function::DebugLocation lastPrintedLocation;
 
-  PrintSExpression(std::ostream& o) : o(o) {
+  PrintSExpression(TextWriter& o) : o(o) {
     setMinify(false);
     if (!full) full = isFullForced();
   }
@@ -55,13 +58,12 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
   void visit(Expression* curr) {
     if (currFunction) {
       // show an annotation, if there is one
-      auto& debugLocations = currFunction->debugLocations;
-      auto iter = debugLocations.find(curr);
-      if (iter != debugLocations.end()) {
-        auto fileName = currModule->debugInfoFileNames[iter->second.fileIndex];
-        if (lastPrintedLocation != iter->second) {
-          lastPrintedLocation = iter->second;
-          o << ";;@ " << fileName << ":" << iter->second.lineNumber << ":" << iter->second.columnNumber << '\n';
+      auto* location = currFunction->debugLocations.get(curr);
+      if (location) {
+        auto fileName = currModule->debugInfoFileNames[location->fileIndex];
+        if (lastPrintedLocation != *location) {
+          lastPrintedLocation = *location;
+          o << ";;@ " << fileName << ":" << location->lineNumber << ":" << location->columnNumber << '\n';
           doIndent(o, indent);
         }
       }
@@ -90,7 +92,7 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
     o << ')';
   }
   void printFullLine(Expression *expression) {
-    !minify && doIndent(o, indent);
+    if (!minify) doIndent(o, indent);
     if (full) {
       o << "[" << printWasmType(expression->type) << "] ";
     }
@@ -109,7 +111,7 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
     return name;
   }
 
-  std::ostream& printName(Name name) {
+  TextWriter& printName(Name name) {
     // we need to quote names if they have tricky chars
     if (strpbrk(name.str, "()")) {
       o << '"' << name << '"';
@@ -350,7 +352,7 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
     printFullLine(curr->value);
     decIndent();
   }
-  static void printRMWSize(std::ostream& o, WasmType type, uint8_t bytes) {
+  static void printRMWSize(TextWriter& o, WasmType type, uint8_t bytes) {
     prepareColor(o) << printWasmType(type) << ".atomic.rmw";
     if (bytes != getWasmTypeSize(type)) {
       if (bytes == 1) {
@@ -656,6 +658,7 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
     o << ')';
   }
   void visitFunction(Function *curr) {
+    curr->materialize();
     currFunction = curr;
     lastPrintedLocation = { 0, 0, 0 };
     printOpening(o, "func ", true);
@@ -754,7 +757,7 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
             if (c >= 32 && c < 127) {
               o << c;
             } else {
-              o << std::hex << '\\' << (c/16) << (c%16) << std::dec;
+              o << '\\' << "0123456789abcdef"[c/16] << "0123456789abcdef"[c%16];
             }
           }
         }
@@ -762,6 +765,61 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
       o << "\")\n";
     }
   }
+  void printFunctions(Module *curr) {
+    size_t num = ThreadPool::get()->size();
+    size_t total = curr->functions.size();
+#ifdef _WIN32
+    num = 1; // colors are set on the console, not written to the stream
+#endif
+    if (num <= 1 || total <= 1 || ThreadPool::isRunning()) {
+      for (auto& child : curr->functions) {
+        doIndent(o, indent);
+        visitFunction(child.get());
+        o << maybeNewLine;
+      }
+      return;
+    }
+    // each function prints the same wherever it is, so print them into
+    // buffers in parallel, then write those out in order. do it in batches,
+    // so that the whole text is not in memory at once
+    const size_t BatchPerWorker = 64;
+    size_t batchSize = BatchPerWorker * num;
+    std::vector<std::string> outputs(batchSize);
+    for (size_t start = 0; start < total; start += batchSize) {
+      size_t end = std::min(start + batchSize, total);
+      std::vector<size_t> costs;
+      for (size_t i = start; i < end; i++) {
+        auto* func = curr->functions[i].get();
+        costs.push_back(func->isLazy() ? func->lazyBody->size : Measurer::measure(func->body));
+      }
+      WorkStealingScheduler scheduler(num, costs);
+      std::vector<std::function<ThreadWorkState ()>> doWorkers;
+      for (size_t i = 0; i < num; i++) {
+        doWorkers.push_back([&, i]() {
+          size_t index;
+          if (!scheduler.getTask(i, index)) {
+            return ThreadWorkState::Finished;
+          }
+          TextWriter buffer;
+          PrintSExpression print(buffer);
+          print.setMinify(minify);
+          print.setFull(full);
+          print.indent = indent;
+          print.currModule = currModule;
+          print.visitFunction(curr->functions[start + index].get());
+          outputs[index].swap(buffer.str());
+          return ThreadWorkState::More;
+        });
+      }
+      ThreadPool::get()->work(doWorkers);
+      for (size_t i = 0; i < end - start; i++) {
+        doIndent(o, indent);
+        o << outputs[i];
+        o << maybeNewLine;
+        std::string().swap(outputs[i]);
+      }
+    }
+  }
   void visitModule(Module *curr) {
     currModule = curr;
     printOpening(o, "module", true);
@@ -797,11 +855,7 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
       printOpening(o, "start") << ' ' << curr->start << ')';
       o << maybeNewLine;
     }
-    for (auto& child : curr->functions) {
-      doIndent(o, indent);
-      visitFunction(child.get());
-      o << maybeNewLine;
-    }
+    printFunctions(curr);
     for (auto& section : curr->userSections) {
       doIndent(o, indent);
       o << ";; custom section \"" << section.name << "\", size " << section.data.size();
@@ -814,7 +868,8 @@ struct PrintSExpression : public Visitor<PrintSExpression> {
 };
 
 void Printer::run(PassRunner* runner, Module* module) {
-  PrintSExpression print(o);
+  TextWriter writer(o);
+  PrintSExpression print(writer);
   print.visitModule(module);
 }
 
@@ -830,7 +885,8 @@ public:
   MinifiedPrinter(std::ostream* o) : Printer(o) {}
 
   void run(PassRunner* runner, Module* module) override {
-    PrintSExpression print(o);
+    TextWriter writer(o);
+    PrintSExpression print(writer);
     print.setMinify(true);
     print.visitModule(module);
   }
@@ -848,7 +904,8 @@ public:
   FullPrinter(std::ostream* o) : Printer(o) {}
 
   void run(PassRunner* runner, Module* module) override {
-    PrintSExpression print(o);
+    TextWriter writer(o);
+    PrintSExpression print(writer);
     print.setFull(true);
     print.visitModule(module);
   }
@@ -865,13 +922,15 @@ std::ostream& WasmPrinter::printExpression(Expression* expression, std::ostream&
     o << "(null expression)";
     return o;
   }
-  PrintSExpression print(o);
+  TextWriter writer(o);
+  PrintSExpression print(writer);
   print.setMinify(minify);
   if (full || isFullForced()) {
     print.setFull(true);
-    o << "[" << printWasmType(expression->type) << "] ";
+    writer << "[" << printWasmType(expression->type) << "] ";
   }
   print.visit(expression);
+  writer.flush();
   return o;
 }
 
@@ -418,8 +418,10 @@ struct RemoveUnusedBrs : public WalkerPass<PostWalker<RemoveUnusedBrs>> {
     struct FinalOptimizer : public PostWalker<FinalOptimizer> {
       bool selectify;
       PassOptions& passOptions;
+      // turning nested ifs into selects looks at the same code at each level
+      EffectCache effectCache;
 
-      FinalOptimizer(PassOptions& passOptions) : passOptions(passOptions) {}
+      FinalOptimizer(PassOptions& passOptions) : passOptions(passOptions), effectCache(passOptions) {}
 
       void visitBlock(Block* curr) {
         // if a block has an if br else br, we can un-conditionalize the latter, allowing
@@ -434,6 +436,7 @@ struct RemoveUnusedBrs : public WalkerPass<PostWalker<RemoveUnusedBrs>> {
           auto* ifTrueBreak = iff->ifTrue->dynCast<Break>();
           if (ifTrueBreak && !ifTrueBreak->condition && canTurnIfIntoBrIf(iff->condition, ifTrueBreak->value, passOptions)) {
             // we are an if-else where the ifTrue is a break without a condition, so we can do this
+            effectCache.clear();
             ifTrueBreak->condition = iff->condition;
             ifTrueBreak->finalize();
             list[i] = Builder(*getModule()).dropIfConcretelyTyped(ifTrueBreak);
@@ -443,6 +446,7 @@ struct RemoveUnusedBrs : public WalkerPass<PostWalker<RemoveUnusedBrs>> {
           // otherwise, perhaps we can flip the if
           auto* ifFalseBreak = iff->ifFalse->dynCast<Break>();
           if (ifFalseBreak && !ifFalseBreak->condition && canTurnIfIntoBrIf(iff->condition, ifFalseBreak->value, passOptions)) {
+            effectCache.clear();
             ifFalseBreak->condition = Builder(*getModule()).makeUnary(EqZInt32, iff->condition);
             ifFalseBreak->finalize();
             list[i] = Builder(*getModule()).dropIfConcretelyTyped(ifFalseBreak);
@@ -461,8 +465,9 @@ struct RemoveUnusedBrs : public WalkerPass<PostWalker<RemoveUnusedBrs>> {
               if (!br2 || !br2->condition) continue;
               if (br1->name == br2->name) {
                 assert(!br1->value && !br2->value);
-                if (!EffectAnalyzer(passOptions, br2->condition).hasSideEffects()) {
+                if (!effectCache.get(br2->condition).hasSideEffects()) {
                   // it's ok to execute them both, do it
+                  effectCache.clear();
                   Builder builder(*getModule());
                   br1->condition = builder.makeBinary(OrInt32, br1->condition, br2->condition);
                   ExpressionManipulator::nop(br2);
@@ -485,6 +490,7 @@ struct RemoveUnusedBrs : public WalkerPass<PostWalker<RemoveUnusedBrs>> {
               assert(!br->value); // can't, it would be dropped or last in the block
               if (BranchUtils::BranchSeeker::countNamed(curr, curr->name) == 1) {
                 // no other breaks to that name, so we can do this
+                effectCache.clear();
                 Builder builder(*getModule());
                 replaceCurrent(builder.makeIf(
                   builder.makeUnary(EqZInt32, br->condition),
@@ -507,17 +513,17 @@ struct RemoveUnusedBrs : public WalkerPass<PostWalker<RemoveUnusedBrs>> {
         if (curr->ifFalse && isConcreteWasmType(curr->ifTrue->type) && isConcreteWasmType(curr->ifFalse->type)) {
           // if with else, consider turning it into a select if there is no control flow
           // TODO: estimate cost
-          EffectAnalyzer condition(passOptions, curr->condition);
-          if (!condition.hasSideEffects()) {
-            EffectAnalyzer ifTrue(passOptions, curr->ifTrue);
-            if (!ifTrue.hasSideEffects()) {
-              EffectAnalyzer ifFalse(passOptions, curr->ifFalse);
-              if (!ifFalse.hasSideEffects()) {
+          if (!effectCache.get(curr->condition).hasSideEffects()) {
+            if (!effectCache.get(curr->ifTrue).hasSideEffects()) {
+              if (!effectCache.get(curr->ifFalse).hasSideEffects()) {
                 auto* select = getModule()->allocator.alloc<Select>();
                 select->condition = curr->condition;
                 select->ifTrue = curr->ifTrue;
                 select->ifFalse = curr->ifFalse;
                 select->finalize();
+                // the select has the same children, so their effects are
+                // still valid
+                effectCache.erase(curr);
                 replaceCurrent(select);
               }
             }
@@ -37,12 +37,18 @@ enum class ModuleElementKind {
 
 typedef std::pair<ModuleElementKind, Name> ModuleElement;
 
+struct ModuleElementHash {
+  size_t operator()(const ModuleElement& element) const {
+    return std::hash<Name>()(element.second) ^ size_t(element.first);
+  }
+};
+
 // Finds reachabilities
 
 struct ReachabilityAnalyzer : public PostWalker<ReachabilityAnalyzer> {
   Module* module;
   std::vector<ModuleElement> queue;
-  std::set<ModuleElement> reachable;
+  std::unordered_set<ModuleElement, ModuleElementHash> reachable;
 
   ReachabilityAnalyzer(Module* module, const std::vector<ModuleElement>& roots) : module(module) {
     queue = roots;
@@ -63,6 +69,7 @@ struct ReachabilityAnalyzer : public PostWalker<ReachabilityAnalyzer> {
           // if not an import, walk it
           auto* func = module->getFunctionOrNull(curr.second);
           if (func) {
+            func->materialize();
             walk(func->body);
           }
         } else {
@@ -124,6 +131,9 @@ struct FunctionTypeAnalyzer : public PostWalker<FunctionTypeAnalyzer> {
 };
 
 struct RemoveUnusedModuleElements : public Pass {
+  // only the functions that are reached are decoded
+  bool handlesLazyFunctions() override { return true; }
+
   void run(PassRunner* runner, Module* module) override {
     optimizeGlobalsAndFunctions(module);
     optimizeFunctionTypes(module);
@@ -51,6 +51,35 @@ struct Vacuum : public WalkerPass<PostWalker<Vacuum>> {
   Expression* optimize(Expression* curr, bool resultUsed) {
     // an unreachable node must not be changed
     if (curr->type == unreachable) return curr;
+    // we may go down a chain of unaries, binaries and selects, looking at the
+    // effects of the children at each step. find those effects bottom-up
+    // first, so that each is looked at once
+    EffectCache effects(getPassOptions());
+    if (!resultUsed) {
+      std::vector<Expression*> chain;
+      std::vector<Expression*> work = { curr };
+      while (!work.empty()) {
+        auto* item = work.back();
+        work.pop_back();
+        if (auto* unary = item->dynCast<Unary>()) {
+          work.push_back(unary->value);
+        } else if (auto* binary = item->dynCast<Binary>()) {
+          work.push_back(binary->left);
+          work.push_back(binary->right);
+        } else if (auto* select = item->dynCast<Select>()) {
+          work.push_back(select->ifTrue);
+          work.push_back(select->ifFalse);
+          work.push_back(select->condition);
+        } else {
+          continue;
+        }
+        // we look at the effects of the children, not of curr itself
+        if (item != curr) chain.push_back(item);
+      }
+      for (auto i = chain.rbegin(); i != chain.rend(); ++i) {
+        effects.get(*i);
+      }
+    }
     while (1) {
       switch (curr->_id) {
         case Expression::Id::NopId: return nullptr; // never needed
@@ -75,7 +104,7 @@ struct Vacuum : public WalkerPass<PostWalker<Vacuum>> {
         case Expression::Id::LoadId: {
           // it is ok to remove a load if the result is not used, and it has no
           // side effects (the load itself may trap, if we are not ignoring such things)
-          if (!resultUsed && !EffectAnalyzer(getPassOptions(), curr).hasSideEffects()) {
+          if (!resultUsed && !effects.get(curr).hasSideEffects()) {
             return curr->cast<Load>()->ptr;
           }
           return curr;
@@ -101,7 +130,7 @@ struct Vacuum : public WalkerPass<PostWalker<Vacuum>> {
             if (tester.hasSideEffects()) {
               return curr;
             }
-            if (EffectAnalyzer(getPassOptions(), unary->value).hasSideEffects()) {
+            if (effects.get(unary->value).hasSideEffects()) {
               curr = unary->value;
               continue;
             } else {
@@ -113,15 +142,15 @@ struct Vacuum : public WalkerPass<PostWalker<Vacuum>> {
             if (tester.hasSideEffects()) {
               return curr;
             }
-            if (EffectAnalyzer(getPassOptions(), binary->left).hasSideEffects()) {
-              if (EffectAnalyzer(getPassOptions(), binary->right).hasSideEffects()) {
+            if (effects.get(binary->left).hasSideEffects()) {
+              if (effects.get(binary->right).hasSideEffects()) {
                 return curr; // leave them
               } else {
                 curr = binary->left;
                 continue;
               }
             } else {
-              if (EffectAnalyzer(getPassOptions(), binary->right).hasSideEffects()) {
+              if (effects.get(binary->right).hasSideEffects()) {
                 curr = binary->right;
                 continue;
               } else {
@@ -131,11 +160,11 @@ struct Vacuum : public WalkerPass<PostWalker<Vacuum>> {
           } else {
             // TODO: if two have side effects, we could replace the select with say an add?
             auto* select = curr->cast<Select>();
-            if (EffectAnalyzer(getPassOptions(), select->ifTrue).hasSideEffects()) {
-              if (EffectAnalyzer(getPassOptions(), select->ifFalse).hasSideEffects()) {
+            if (effects.get(select->ifTrue).hasSideEffects()) {
+              if (effects.get(select->ifFalse).hasSideEffects()) {
                 return curr; // leave them
               } else {
-                if (EffectAnalyzer(getPassOptions(), select->condition).hasSideEffects()) {
+                if (effects.get(select->condition).hasSideEffects()) {
                   return curr; // leave them
                 } else {
                   curr = select->ifTrue;
@@ -143,15 +172,15 @@ struct Vacuum : public WalkerPass<PostWalker<Vacuum>> {
                 }
               }
             } else {
-              if (EffectAnalyzer(getPassOptions(), select->ifFalse).hasSideEffects()) {
-                if (EffectAnalyzer(getPassOptions(), select->condition).hasSideEffects()) {
+              if (effects.get(select->ifFalse).hasSideEffects()) {
+                if (effects.get(select->condition).hasSideEffects()) {
                   return curr; // leave them
                 } else {
                   curr = select->ifFalse;
                   continue;
                 }
               } else {
-                if (EffectAnalyzer(getPassOptions(), select->condition).hasSideEffects()) {
+                if (effects.get(select->condition).hasSideEffects()) {
                   curr = select->condition;
                   continue;
                 } else {
@@ -177,6 +206,7 @@ struct Vacuum : public WalkerPass<PostWalker<Vacuum>> {
       auto* optimized = optimize(child, z == size - 1 && isConcreteWasmType(curr->type));
       if (!optimized) {
         typeUpdater.noteRecursiveRemoval(child);
+        ExpressionManipulator::recycleRecursively(child, *getModule(), getFunction());
         skip++;
       } else {
         if (optimized != child) {
@@ -189,11 +219,11 @@ struct Vacuum : public WalkerPass<PostWalker<Vacuum>> {
         }
         // if this is unreachable, the rest is dead code
         if (list[z - skip]->type == unreachable && z < size - 1) {
-          for (Index i = z - skip + 1; i < list.size(); i++) {
+          // everything before z + 1 was either moved or already removed
+          for (Index i = z + 1; i < size; i++) {
             auto* remove = list[i];
-            if (remove) {
-              typeUpdater.noteRecursiveRemoval(remove);
-            }
+            typeUpdater.noteRecursiveRemoval(remove);
+            ExpressionManipulator::recycleRecursively(remove, *getModule(), getFunction());
           }
           list.resize(z - skip + 1);
           typeUpdater.maybeUpdateTypeToUnreachable(curr);
@@ -215,15 +245,18 @@ struct Vacuum : public WalkerPass<PostWalker<Vacuum>> {
     // we can just return the ifTrue or ifFalse.
     if (auto* value = curr->condition->dynCast<Const>()) {
       Expression* child;
+      Expression* dead = nullptr;
       if (value->value.getInteger()) {
         child = curr->ifTrue;
         if (curr->ifFalse) {
           typeUpdater.noteRecursiveRemoval(curr->ifFalse);
+          dead = curr->ifFalse;
         }
       } else {
         if (curr->ifFalse) {
           child = curr->ifFalse;
           typeUpdater.noteRecursiveRemoval(curr->ifTrue);
+          dead = curr->ifTrue;
         } else {
           typeUpdater.noteRecursiveRemoval(curr);
           ExpressionManipulator::nop(curr);
@@ -231,6 +264,12 @@ struct Vacuum : public WalkerPass<PostWalker<Vacuum>> {
         }
       }
       replaceCurrent(child);
+      if (dead) {
+        ExpressionManipulator::recycleRecursively(dead, *getModule(), getFunction());
+      }
+      typeUpdater.noteRemoval(value);
+      ExpressionManipulator::recycle(value, *getModule(), getFunction());
+      ExpressionManipulator::recycle(curr, *getModule(), getFunction());
       return;
     }
     // if the condition is unreachable, just return it
@@ -0,0 +1,332 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "passes/function-cache.h"
+#include "wasm-binary.h"
+#include "wasm-traversal.h"
+#include "ast/literal-utils.h"
+#include "ast/manipulation.h"
+
+namespace wasm {
+
+// Bump this when the encoding or the keys change.
+static const char* CacheVersion = "binaryen function cache 1";
+
+typedef FunctionCache::Entry Entry;
+
+// Notes the module elements a function body refers to, in order of first use.
+struct ContextScanner : public PostWalker<ContextScanner> {
+  Module* wasm;
+  Entry& entry;
+  std::unordered_set<Name> seen[4];
+
+  ContextScanner(Module* wasm, Entry& entry) : wasm(wasm), entry(entry) {}
+
+  void note(Index kind, std::vector<Name>& list, Name name) {
+    if (seen[kind].insert(name).second) list.push_back(name);
+  }
+
+  void visitCall(Call* curr) {
+    note(0, entry.functions, curr->target);
+  }
+  void visitCallImport(CallImport* curr) {
+    note(1, entry.imports, curr->target);
+  }
+  void visitCallIndirect(CallIndirect* curr) {
+    note(3, entry.types, curr->fullType);
+  }
+  void visitGetGlobal(GetGlobal* curr) {
+    noteGlobal(curr->name);
+  }
+  void visitSetGlobal(SetGlobal* curr) {
+    noteGlobal(curr->name);
+  }
+  void noteGlobal(Name name) {
+    if (wasm->getGlobalOrNull(name)) {
+      note(2, entry.globals, name);
+    } else {
+      note(1, entry.imports, name);
+    }
+  }
+};
+
+static FunctionType* copyType(FunctionType* type) {
+  auto* ret = new FunctionType;
+  ret->name = type->name;
+  ret->params = type->params;
+  ret->result = type->result;
+  return ret;
+}
+
+// Encodes a function with the given body, as a small module of its own with
+// the context it refers to. Nothing in the binary depends on the names in
+// the context, only on their order.
+static std::string encodeFunction(Module& wasm, const Entry& context, Function* func, Expression* body) {
+  Module mini;
+  mini.memory.exists = wasm.memory.exists;
+  mini.memory.initial = wasm.memory.initial;
+  mini.memory.max = wasm.memory.max;
+  mini.memory.shared = wasm.memory.shared;
+  mini.table.exists = wasm.table.exists;
+  mini.table.initial = wasm.table.initial;
+  mini.table.max = wasm.table.max;
+  std::unordered_set<Name> types;
+  auto addType = [&](Name name) {
+    if (name.is() && types.insert(name).second) {
+      mini.addFunctionType(copyType(wasm.getFunctionType(name)));
+    }
+  };
+  // the types that call_indirects use come first, so that their indexes
+  // only depend on the context
+  for (auto name : context.types) {
+    addType(name);
+  }
+  for (auto name : context.imports) {
+    auto* import = wasm.getImport(name);
+    auto* curr = new Import;
+    curr->name = import->name;
+    curr->module = import->module;
+    curr->base = import->base;
+    curr->kind = import->kind;
+    curr->functionType = import->functionType;
+    curr->globalType = import->globalType;
+    addType(curr->functionType);
+    mini.addImport(curr);
+  }
+  for (auto name : context.globals) {
+    auto* global = wasm.getGlobal(name);
+    auto* curr = new Global;
+    curr->name = global->name;
+    curr->type = global->type;
+    curr->mutable_ = global->mutable_;
+    curr->init = LiteralUtils::makeZero(global->type, mini); // passes do not look at it
+    mini.addGlobal(curr);
+  }
+  Builder builder(mini);
+  for (auto name : context.functions) {
+    if (name == func->name) continue;
+    auto* callee = wasm.getFunction(name);
+    auto* stub = new Function;
+    stub->name = callee->name;
+    stub->params = callee->params;
+    stub->result = callee->result;
+    stub->type = callee->type;
+    addType(stub->type);
+    stub->body = builder.makeUnreachable();
+    mini.addFunction(stub);
+  }
+  auto* curr = new Function;
+  curr->name = func->name;
+  curr->params = func->params;
+  curr->result = func->result;
+  curr->vars = func->vars;
+  curr->type = func->type;
+  addType(curr->type);
+  curr->body = body; // not owned by mini, which does not free it anyhow
+  mini.addFunction(curr);
+  BufferWithRandomAccess buffer(false);
+  WasmBinaryWriter writer(&mini, buffer, false);
+  writer.setNamesSection(false);
+  writer.setCompactSizes(true);
+  writer.write();
+  return std::string(buffer.begin(), buffer.end());
+}
+
+// Gives a function the body from an encoding by encodeFunction(), mapping
+// the elements it refers to back by their order in the context. Returns
+// false if the encoding does not fit.
+static bool decodeFunction(Module& wasm, const Entry& context, Function* func, const char* data, size_t size) {
+  Module mini;
+  try {
+    WasmBinaryBuilder parser(mini, data, size, false);
+    parser.read();
+  } catch (ParseException& p) {
+    return false;
+  }
+  // the binary names things by their index, map those to the context
+  std::unordered_map<Name, Name> functions, imports, types;
+  size_t numStubs = mini.functions.size() - 1;
+  if (mini.functions.empty() || mini.imports.size() != context.imports.size() ||
+      mini.globals.size() != context.globals.size() || mini.functionTypes.size() < context.types.size()) {
+    return false;
+  }
+  Index stub = 0;
+  for (auto name : context.functions) {
+    if (name == func->name) continue;
+    if (stub >= numStubs) return false;
+    functions[mini.functions[stub++]->name] = name;
+  }
+  if (stub != numStubs) return false;
+  auto* decoded = mini.functions.back().get();
+  functions[decoded->name] = func->name;
+  for (Index i = 0; i < context.imports.size(); i++) {
+    imports[mini.imports[i]->name] = context.imports[i];
+  }
+  for (Index i = 0; i < context.globals.size(); i++) {
+    imports[mini.globals[i]->name] = context.globals[i];
+  }
+  for (Index i = 0; i < context.types.size(); i++) {
+    types[mini.functionTypes[i]->name] = context.types[i];
+  }
+  struct Renamer : public PostWalker<Renamer> {
+    std::unordered_map<Name, Name> &functions, &globals, &types;
+    bool ok = true;
+
+    Renamer(std::unordered_map<Name, Name>& functions, std::unordered_map<Name, Name>& globals, std::unordered_map<Name, Name>& types) : functions(functions), globals(globals), types(types) {}
+
+    void rename(std::unordered_map<Name, Name>& map, Name& name) {
+      auto iter = map.find(name);
+      if (iter == map.end()) {
+        ok = false;
+        return;
+      }
+      name = iter->second;
+    }
+
+    void visitCall(Call* curr) { rename(functions, curr->target); }
+    void visitCallImport(CallImport* curr) { rename(globals, curr->target); }
+    void visitCallIndirect(CallIndirect* curr) { rename(types, curr->fullType); }
+    void visitGetGlobal(GetGlobal* curr) { rename(globals, curr->name); }
+    void visitSetGlobal(SetGlobal* curr) { rename(globals, curr->name); }
+  };
+  // imports and globals share a namespace, so they can share a map too
+  Renamer renamer(functions, imports, types);
+  renamer.walk(decoded->body);
+  if (!renamer.ok || decoded->params != func->params || decoded->result != func->result) {
+    return false;
+  }
+  func->body = ExpressionManipulator::copy(decoded->body, wasm);
+  func->vars = decoded->vars;
+  func->localNames = decoded->localNames;
+  func->localIndices = decoded->localIndices;
+  return true;
+}
+
+// FNV-1a, which unlike std::hash is the same everywhere
+static uint64_t hashKey(const std::string& key) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : key) {
+    hash = (hash ^ c) * 1099511628211ULL;
+  }
+  return hash;
+}
+
+FunctionCache::FunctionCache(std::string directory, Module& wasm, const std::vector<Pass*>& passes, const PassOptions& options) : directory(directory), wasm(wasm) {
+  std::ostringstream ss;
+  ss << CacheVersion << '\n';
+  if (options.debugInfo) return; // not usable
+  for (auto* pass : passes) {
+    if (pass->name.empty()) return; // not usable
+    ss << pass->name << ' ';
+  }
+  ss << "\nO" << options.optimizeLevel << " s" << options.shrinkLevel
+     << " traps " << options.ignoreImplicitTraps << '\n';
+  pipeline = ss.str();
+#ifdef _WIN32
+  _mkdir(directory.c_str());
+#else
+  mkdir(directory.c_str(), 0777);
+#endif
+}
+
+static std::string getPath(const std::string& directory, const std::string& key) {
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hashKey(key));
+  return directory + "/" + hex;
+}
+
+// A cache file has the size of the key, the key, and then the result.
+
+bool FunctionCache::load(Function* func, Entry& entry) {
+  entry = Entry();
+  func->materialize();
+  // debug info would be lost in the binary form
+  if (!isUsable() || !func->debugLocations.empty()) return false;
+  ContextScanner(&wasm, entry).walk(func->body);
+  entry.key = pipeline + encodeFunction(wasm, entry, func, func->body);
+  std::ifstream file(getPath(directory, entry.key), std::ios::in | std::ios::binary);
+  if (!file) return false;
+  std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  uint64_t keySize;
+  if (contents.size() < sizeof(keySize)) return false;
+  memcpy(&keySize, contents.data(), sizeof(keySize));
+  if (contents.size() - sizeof(keySize) < keySize || contents.compare(sizeof(keySize), keySize, entry.key) != 0) {
+    return false; // a different function with the same hash
+  }
+  size_t start = sizeof(keySize) + keySize;
+  return decodeFunction(wasm, entry, func, contents.data() + start, contents.size() - start);
+}
+
+void FunctionCache::store(Function* func, const Entry& entry) {
+  if (entry.key.empty()) return;
+  // the result is encoded with the context of the original body, which is
+  // what a later lookup will have. passes do not make a function refer to
+  // new module elements, but if one did, the result cannot be encoded
+  Entry after;
+  ContextScanner scanner(&wasm, after);
+  scanner.walk(func->body);
+  auto isIn = [](const std::vector<Name>& used, const std::vector<Name>& context) {
+    for (auto name : used) {
+      if (std::find(context.begin(), context.end(), name) == context.end()) return false;
+    }
+    return true;
+  };
+  if (!isIn(after.functions, entry.functions) || !isIn(after.imports, entry.imports) ||
+      !isIn(after.globals, entry.globals) || !isIn(after.types, entry.types)) {
+    return;
+  }
+  auto result = encodeFunction(wasm, entry, func, func->body);
+  // use the decoded body, just like a later hit would
+  if (!decodeFunction(wasm, entry, func, result.data(), result.size())) return;
+  auto path = getPath(directory, entry.key);
+  std::hash<std::thread::id> hasher;
+  auto temp = path + ".tmp" + std::to_string(hasher(std::this_thread::get_id()));
+  {
+    std::ofstream file(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file) return;
+    uint64_t keySize = entry.key.size();
+    file.write((const char*)&keySize, sizeof(keySize));
+    file.write(entry.key.data(), entry.key.size());
+    file.write(result.data(), result.size());
+    if (!file) {
+      file.close();
+      std::remove(temp.c_str());
+      return;
+    }
+  }
+  // another process may be writing the same entry, but each writes all of
+  // it before the rename, which replaces the entry at once
+  std::rename(temp.c_str(), path.c_str());
+}
+
+} // namespace wasm
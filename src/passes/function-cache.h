@@ -0,0 +1,75 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// An on-disk cache of the results of function-parallel passes, so that
+// functions that did not change since an earlier run are not optimized
+// again.
+//
+// A function is keyed by the passes and options being run, and by its
+// encoding as a small standalone binary: the function itself, plus the
+// types, imports and globals it refers to, and the signatures of the
+// functions it calls. Those are encoded by their position, not their name,
+// so renaming them does not affect the key. The result is stored in the same
+// form.
+//
+// Both hits and misses give the function the body as decoded from that
+// form, so the output does not depend on what was in the cache.
+//
+
+#ifndef wasm_passes_function_cache_h
+#define wasm_passes_function_cache_h
+
+#include <string>
+#include <vector>
+
+#include "wasm.h"
+#include "pass.h"
+
+namespace wasm {
+
+class FunctionCache {
+  std::string directory;
+  std::string pipeline;
+  Module& wasm;
+
+public:
+  FunctionCache(std::string directory, Module& wasm, const std::vector<Pass*>& passes, const PassOptions& options);
+
+  // Whether the passes can be cached at all. They must all be registered
+  // passes, created by name, so that the name tells what they do. And as
+  // the binary form has no local names, debug info must not be wanted.
+  bool isUsable() { return !pipeline.empty(); }
+
+  // What a lookup found out about a function: its key, and the module
+  // elements it refers to, in the order they were encoded in.
+  struct Entry {
+    std::string key;
+    std::vector<Name> functions, imports, globals, types;
+  };
+
+  // Looks up the result of the passes on a function. On a hit, the function
+  // gets that result, and true is returned. Otherwise entry is filled in for
+  // store().
+  bool load(Function* func, Entry& entry);
+
+  // Stores the result of the passes on a function, after a miss.
+  void store(Function* func, const Entry& entry);
+};
+
+} // namespace wasm
+
+#endif // wasm_passes_function_cache_h
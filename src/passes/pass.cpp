@@ -19,7 +19,9 @@
 
 #include <support/colors.h>
 #include <passes/passes.h>
+#include <passes/function-cache.h>
 #include <pass.h>
+#include <ast_utils.h>
 #include <wasm-validator.h>
 
 namespace wasm {
@@ -202,7 +204,7 @@ void PassRunner::run() {
           runPassOnFunction(pass, func.get());
         }
       } else {
-        pass->run(this, wasm);
+        runPassOnModule(pass);
       }
       auto after = std::chrono::steady_clock::now();
       std::chrono::duration<double> diff = after - before;
@@ -237,29 +239,68 @@ void PassRunner::run() {
       if (stack.size() > 0) {
         // run the stack of passes on all the functions, in parallel
         size_t num = ThreadPool::get()->size();
-        std::vector<std::function<ThreadWorkState ()>> doWorkers;
-        std::atomic<size_t> nextFunction;
-        nextFunction.store(0);
         size_t numFunctions = wasm->functions.size();
+        // when parallel, schedule the largest functions first, so that a
+        // big function near the end does not leave the other cores idle
+        std::vector<size_t> costs(numFunctions, 0);
+        if (num > 1) {
+          for (size_t i = 0; i < numFunctions; i++) {
+            auto* func = wasm->functions[i].get();
+            costs[i] = func->isLazy() ? func->lazyBody->size : Measurer::measure(func->body);
+          }
+        }
+        WorkStealingScheduler scheduler(num, costs);
+        std::unique_ptr<FunctionCache> cache;
+        if (!options.cacheDirectory.empty()) {
+          cache = make_unique<FunctionCache>(options.cacheDirectory, *wasm, stack, options);
+          if (!cache->isUsable()) cache.reset();
+        }
+        // when reclaiming memory, each worker has a scratch arena for what
+        // the passes allocate, and a home arena it moves function bodies
+        // into. those are created on the worker's thread, when first used
+        std::vector<std::unique_ptr<MixedArena>> scratches(num), homes(num);
+        std::vector<std::function<ThreadWorkState ()>> doWorkers;
         for (size_t i = 0; i < num; i++) {
-          doWorkers.push_back([&]() {
-            auto index = nextFunction.fetch_add(1);
+          doWorkers.push_back([&, i]() {
+            size_t index;
             // get the next task, if there is one
-            if (index >= numFunctions) {
+            if (!scheduler.getTask(i, index)) {
               return ThreadWorkState::Finished; // nothing left
             }
             Function* func = this->wasm->functions[index].get();
+            if (options.reclaimMemory && !homes[i]) {
+              scratches[i] = make_unique<MixedArena>();
+              homes[i] = make_unique<MixedArena>();
+            }
+            // what the cache gives a function must end up in its home too
+            std::unique_ptr<MixedArena::ScopedRedirect> redirect;
+            FunctionCache::Entry entry;
+            if (cache) {
+              if (options.reclaimMemory) redirect = make_unique<MixedArena::ScopedRedirect>(wasm->allocator, *homes[i]);
+              if (cache->load(func, entry)) {
+                return ThreadWorkState::More;
+              }
+              redirect.reset();
+            }
             // do the current task: run all passes on this function
-            for (auto* pass : stack) {
-              runPassOnFunction(pass, func);
+            if (options.reclaimMemory) {
+              runPassesOnFunctionReclaimingMemory(stack, func, *scratches[i], *homes[i]);
+            } else {
+              for (auto* pass : stack) {
+                runPassOnFunction(pass, func);
+              }
             }
-            if (index + 1 == numFunctions) {
-              return ThreadWorkState::Finished; // we did the last one
+            if (cache) {
+              if (options.reclaimMemory) redirect = make_unique<MixedArena::ScopedRedirect>(wasm->allocator, *homes[i]);
+              cache->store(func, entry);
             }
             return ThreadWorkState::More;
           });
         }
         ThreadPool::get()->work(doWorkers);
+        if (options.reclaimMemory) {
+          reclaimModuleMemory(homes);
+        }
       }
       stack.clear();
     };
@@ -268,7 +309,7 @@ void PassRunner::run() {
         stack.push_back(pass);
       } else {
         flush();
-        pass->run(this, wasm);
+        runPassOnModule(pass);
       }
     }
     flush();
@@ -297,11 +338,88 @@ void PassRunner::doAdd(Pass* pass) {
 
 void PassRunner::runPassOnFunction(Pass* pass, Function* func) {
   assert(pass->isFunctionParallel());
+  func->materialize();
   // function-parallel passes get a new instance per function
   auto instance = std::unique_ptr<Pass>(pass->create());
   instance->runFunction(this, wasm, func);
 }
 
+void PassRunner::runPassOnModule(Pass* pass) {
+  if (!pass->handlesLazyFunctions()) {
+    for (auto& func : wasm->functions) {
+      func->materialize();
+    }
+  }
+  pass->run(this, wasm);
+}
+
+void PassRunner::runPassesOnFunctionReclaimingMemory(std::vector<Pass*>& stack, Function* func, MixedArena& scratch, MixedArena& home) {
+  {
+    MixedArena::ScopedRedirect redirect(wasm->allocator, scratch);
+    for (auto* pass : stack) {
+      runPassOnFunction(pass, func);
+    }
+  }
+  // copy the body into its new home. the copy is built using Builder, which
+  // finalizes node types itself, so copy the types over as well, to keep
+  // the body exactly as the passes left it
+  struct Lister : public PostWalker<Lister, UnifiedExpressionVisitor<Lister>> {
+    std::vector<Expression*> list;
+
+    void visitExpression(Expression* curr) {
+      list.push_back(curr);
+    }
+  };
+  Lister before, after;
+  before.walk(func->body);
+  {
+    MixedArena::ScopedRedirect redirect(wasm->allocator, home);
+    func->body = ExpressionManipulator::copy(func->body, *wasm);
+  }
+  after.walk(func->body);
+  assert(before.list.size() == after.list.size());
+  SortedMap<Expression*, Function::DebugLocation> debugLocations;
+  debugLocations.reserve(func->debugLocations.size());
+  for (size_t i = 0; i < before.list.size(); i++) {
+    after.list[i]->type = before.list[i]->type;
+    if (!func->debugLocations.empty()) {
+      if (auto* location = func->debugLocations.get(before.list[i])) {
+        debugLocations.set(after.list[i], *location);
+      }
+    }
+  }
+  func->debugLocations.swap(debugLocations);
+  // nothing refers to what the passes allocated any more
+  scratch.clear();
+}
+
+void PassRunner::reclaimModuleMemory(std::vector<std::unique_ptr<MixedArena>>& homes) {
+  // all function bodies are now in the new homes. move the module-level
+  // code too, after which nothing refers to the module's own arena, nor to
+  // the homes from before
+  auto moduleHome = make_unique<MixedArena>();
+  {
+    MixedArena::ScopedRedirect redirect(wasm->allocator, *moduleHome);
+    for (auto& global : wasm->globals) {
+      global->init = ExpressionManipulator::copy(global->init, *wasm);
+    }
+    for (auto& segment : wasm->table.segments) {
+      segment.offset = ExpressionManipulator::copy(segment.offset, *wasm);
+    }
+    for (auto& segment : wasm->memory.segments) {
+      segment.offset = ExpressionManipulator::copy(segment.offset, *wasm);
+    }
+  }
+  wasm->allocator.clear();
+  wasm->bodyArenas.clear();
+  wasm->bodyArenas.push_back(std::move(moduleHome));
+  for (auto& home : homes) {
+    if (home) {
+      wasm->bodyArenas.push_back(std::move(home));
+    }
+  }
+}
+
 int PassRunner::getPassDebug() {
   static const int passDebug = getenv("BINARYEN_PASS_DEBUG") ? atoi(getenv("BINARYEN_PASS_DEBUG")) : 0;
   return passDebug;
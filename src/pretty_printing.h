@@ -24,45 +24,63 @@
 #include <ostream>
 
 #include "support/colors.h"
+#include "support/text-writer.h"
 
-inline std::ostream &doIndent(std::ostream &o, unsigned indent) {
+// The helpers below write to an std::ostream or a wasm::TextWriter.
+
+inline void printColor(std::ostream &o, void (*setColor)(std::ostream&)) {
+  setColor(o);
+}
+
+inline void printColor(wasm::TextWriter &o, void (*setColor)(std::ostream&)) {
+  o.color(setColor);
+}
+
+template<typename Stream>
+inline Stream &doIndent(Stream &o, unsigned indent) {
   for (unsigned i = 0; i < indent; i++) {
-    o << " ";
+    o << ' ';
   }
   return o;
 }
 
-inline std::ostream &prepareMajorColor(std::ostream &o) {
-  Colors::red(o);
-  Colors::bold(o);
+template<typename Stream>
+inline Stream &prepareMajorColor(Stream &o) {
+  printColor(o, Colors::red);
+  printColor(o, Colors::bold);
   return o;
 }
 
-inline std::ostream &prepareColor(std::ostream &o) {
-  Colors::magenta(o);
-  Colors::bold(o);
+template<typename Stream>
+inline Stream &prepareColor(Stream &o) {
+  printColor(o, Colors::magenta);
+  printColor(o, Colors::bold);
   return o;
 }
 
-inline std::ostream &prepareMinorColor(std::ostream &o) {
-  Colors::orange(o);
+template<typename Stream>
+inline Stream &prepareMinorColor(Stream &o) {
+  printColor(o, Colors::orange);
   return o;
 }
 
-inline std::ostream &restoreNormalColor(std::ostream &o) {
-  Colors::normal(o);
+template<typename Stream>
+inline Stream &restoreNormalColor(Stream &o) {
+  printColor(o, Colors::normal);
   return o;
 }
 
-inline std::ostream& printText(std::ostream &o, const char *str) {
+template<typename Stream>
+inline Stream& printText(Stream &o, const char *str) {
   o << '"';
-  Colors::green(o);
+  printColor(o, Colors::green);
   o << str;
-  Colors::normal(o);
+  printColor(o, Colors::normal);
   return o << '"';
 }
 
-inline std::ostream& printOpening(std::ostream &o, const char *str, bool major=false) {
+template<typename Stream>
+inline Stream& printOpening(Stream &o, const char *str, bool major=false) {
   o << '(';
   major ? prepareMajorColor(o) : prepareColor(o);
   o << str;
@@ -70,7 +88,8 @@ inline std::ostream& printOpening(std::ostream &o, const char *str, bool major=f
   return o;
 }
 
-inline std::ostream& printMinorOpening(std::ostream &o, const char *str) {
+template<typename Stream>
+inline Stream& printMinorOpening(Stream &o, const char *str) {
   o << '(';
   prepareMinorColor(o);
   o << str;
@@ -760,7 +760,7 @@ class S2WasmBuilder {
     std::vector<Expression*> bstack;
     auto addToBlock = [&](Expression* curr) {
       if (useDebugLocation) {
-        func->debugLocations[curr] = debugLocation;
+        func->debugLocations.set(curr, debugLocation);
       }
       Expression* last = bstack.back();
       if (last->is<Loop>()) {
@@ -28,27 +28,37 @@ void Colors::disable() { colors_disabled = true; }
 #if defined(__linux__) || defined(__APPLE__)
 #include <unistd.h>
 
-void Colors::outputColorCode(std::ostream& stream, const char* colorCode) {
+bool Colors::isEnabled() {
   const static bool has_color = []() {
     return (getenv("COLORS") && getenv("COLORS")[0] == '1') ||  // forced
            (isatty(STDOUT_FILENO) &&
             (!getenv("COLORS") || getenv("COLORS")[0] != '0'));  // implicit
   }();
-  if (has_color && !colors_disabled) stream << colorCode;
+  return has_color && !colors_disabled;
+}
+
+void Colors::outputColorCode(std::ostream& stream, const char* colorCode) {
+  if (isEnabled()) stream << colorCode;
 }
 #elif defined(_WIN32)
 #include <windows.h>
 #include <io.h>
 #include <iostream>
 
-void Colors::outputColorCode(std::ostream&stream, const WORD &colorCode) {
+bool Colors::isEnabled() {
   const static bool has_color = []() {
     return _isatty(_fileno(stdout)) &&
             (!getenv("COLORS") || getenv("COLORS")[0] != '0');  // implicit
   }();
+  return has_color && !colors_disabled;
+}
+
+void Colors::outputColorCode(std::ostream&stream, const WORD &colorCode) {
   static HANDLE hStdout = GetStdHandle(STD_OUTPUT_HANDLE);
   static HANDLE hStderr = GetStdHandle(STD_ERROR_HANDLE);
-  if (has_color && !colors_disabled)
+  if (isEnabled())
     SetConsoleTextAttribute(&stream == &std::cout ? hStdout : hStderr, colorCode);
 }
+#else
+bool Colors::isEnabled() { return false; }
 #endif
@@ -22,6 +22,9 @@
 namespace Colors {
 void disable();
 
+// Whether the color functions below output anything.
+bool isEnabled();
+
 #if defined(__linux__) || defined(__APPLE__)
 void outputColorCode(std::ostream& stream, const char *colorCode);
 inline void normal(std::ostream& stream) { outputColorCode(stream,"\033[0m"); }
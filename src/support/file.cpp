@@ -21,6 +21,14 @@
 #include <cstdint>
 #include <limits>
 
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAVE_MMAP 1
+#endif
+
 template <typename T>
 T wasm::read_file(const std::string &filename, Flags::BinaryOption binary, Flags::DebugOption debug) {
   if (debug == Flags::Debug) std::cerr << "Loading '" << filename << "'..." << std::endl;
@@ -55,6 +63,37 @@ T wasm::read_file(const std::string &filename, Flags::BinaryOption binary, Flags
 template std::string wasm::read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 template std::vector<char> wasm::read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 
+wasm::MappedFile::MappedFile(const std::string &filename, Flags::DebugOption debug) {
+#ifdef HAVE_MMAP
+  int fd = open(filename.c_str(), O_RDONLY);
+  if (fd >= 0) {
+    struct stat info;
+    // only regular, non-empty files can be mapped; leave the rest to read_file
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+      void* addr = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        if (debug == Flags::Debug) std::cerr << "Mapped '" << filename << "'" << std::endl;
+        mapped = static_cast<const char*>(addr);
+        mappedSize = size_t(info.st_size);
+        // the whole file will be read from start to end
+        madvise(addr, mappedSize, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);
+  }
+  if (mapped) return;
+#endif
+  contents = read_file<std::vector<char>>(filename, Flags::Binary, debug);
+}
+
+wasm::MappedFile::~MappedFile() {
+#ifdef HAVE_MMAP
+  if (mapped) {
+    munmap(const_cast<char*>(mapped), mappedSize);
+  }
+#endif
+}
+
 wasm::Output::Output(const std::string &filename, Flags::BinaryOption binary, Flags::DebugOption debug)
     : outfile(), out([this, filename, binary, debug]() {
         std::streambuf *buffer;
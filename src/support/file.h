@@ -45,6 +45,30 @@ T read_file(const std::string &filename, Flags::BinaryOption binary, Flags::Debu
 extern template std::string read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 extern template std::vector<char> read_file<>(const std::string &, Flags::BinaryOption, Flags::DebugOption);
 
+// The contents of a binary file, read-only. Where the platform allows, the
+// file is mapped into memory rather than read, so nothing is copied and its
+// pages are shared with the OS's file cache. Otherwise it is read with
+// read_file.
+class MappedFile {
+ public:
+  MappedFile(const std::string &filename, Flags::DebugOption debug);
+  ~MappedFile();
+
+  const char* data() const {
+    return mapped ? mapped : contents.data();
+  }
+  size_t size() const {
+    return mapped ? mappedSize : contents.size();
+  }
+
+ private:
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  const char* mapped = nullptr;
+  size_t mappedSize = 0;
+  std::vector<char> contents; // when not mapped
+};
+
 class Output {
  public:
   // An empty filename will open stdout instead.
@@ -20,6 +20,7 @@
 #include <cstring>
 
 #include "emscripten-optimizer/istring.h"
+#include "support/text-writer.h"
 
 namespace wasm {
 
@@ -43,6 +44,10 @@ struct Name : public cashew::IString {
     assert(name.str);
     return o << '$' << name.str; // reference interpreter requires we prefix all names
   }
+  friend TextWriter& operator<<(TextWriter& o, Name name) {
+    assert(name.str);
+    return o << '$' << name.str;
+  }
 
   static Name fromInt(size_t i) {
     return cashew::IString(std::to_string(i).c_str(), false);
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A map from Names to values, as a flat open-addressing hash table with
+// linear probing. Names are interned, so keys are hashed and compared by
+// their pointer alone, and a lookup is usually a single cache miss.
+//
+// The null Name marks an empty slot, so it cannot be used as a key.
+// Removal shifts later entries in the probe sequence back, so there are
+// no tombstones and lookups stay short after many removals.
+//
+
+#ifndef wasm_support_name_map_h
+#define wasm_support_name_map_h
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "support/name.h"
+
+namespace wasm {
+
+template<typename T>
+class NameMap {
+  struct Entry {
+    Name key;
+    T value;
+  };
+
+  std::vector<Entry> entries; // a power of 2 in size, or empty
+  size_t used = 0;
+
+  size_t mask() const {
+    return entries.size() - 1;
+  }
+
+  size_t slotFor(Name key) const {
+    // fibonacci hashing: the low bits of the pointer are mostly alignment,
+    // so mix everything into the high bits
+    uint64_t hash = uint64_t(uintptr_t(key.str)) * 0x9e3779b97f4a7c15ULL;
+    return size_t(hash >> 32) & mask();
+  }
+
+  // Returns the slot of a key, or the empty slot where it would go.
+  size_t find(Name key) const {
+    size_t i = slotFor(key);
+    while (entries[i].key.is() && entries[i].key != key) {
+      i = (i + 1) & mask();
+    }
+    return i;
+  }
+
+  void rehash(size_t capacity) {
+    std::vector<Entry> old;
+    old.swap(entries);
+    entries.resize(capacity);
+    for (auto& entry : old) {
+      if (entry.key.is()) {
+        entries[find(entry.key)] = entry;
+      }
+    }
+  }
+
+public:
+  size_t size() const {
+    return used;
+  }
+
+  bool has(Name key) const {
+    assert(key.is());
+    return used > 0 && entries[find(key)].key.is();
+  }
+
+  // Returns the value for a key, or a default-constructed value if the key
+  // is not present.
+  T get(Name key) const {
+    assert(key.is());
+    if (used == 0) return T();
+    auto& entry = entries[find(key)];
+    return entry.key.is() ? entry.value : T();
+  }
+
+  void set(Name key, T value) {
+    assert(key.is());
+    // keep the load factor under 1/2
+    if ((used + 1) * 2 > entries.size()) {
+      rehash(entries.empty() ? 16 : entries.size() * 2);
+    }
+    auto& entry = entries[find(key)];
+    if (!entry.key.is()) {
+      entry.key = key;
+      used++;
+    }
+    entry.value = value;
+  }
+
+  // Returns whether the key was present.
+  bool erase(Name key) {
+    assert(key.is());
+    if (used == 0) return false;
+    size_t hole = find(key);
+    if (!entries[hole].key.is()) return false;
+    // shift back later entries whose probe sequence passes through the hole
+    size_t i = hole;
+    while (1) {
+      i = (i + 1) & mask();
+      if (!entries[i].key.is()) break;
+      size_t ideal = slotFor(entries[i].key);
+      // the entry can move if the hole lies cyclically in [ideal, i)
+      if (((i - ideal) & mask()) >= ((i - hole) & mask())) {
+        entries[hole] = entries[i];
+        hole = i;
+      }
+    }
+    entries[hole] = Entry();
+    used--;
+    return true;
+  }
+
+  void clear() {
+    entries.clear();
+    used = 0;
+  }
+
+  void reserve(size_t size) {
+    size_t capacity = entries.empty() ? 16 : entries.size();
+    while (size * 2 > capacity) {
+      capacity *= 2;
+    }
+    if (capacity > entries.size()) {
+      rehash(capacity);
+    }
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_support_name_map_h
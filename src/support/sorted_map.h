@@ -0,0 +1,159 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A map kept as a vector of entries sorted by key, for side tables with many
+// small entries, like the debug locations of expressions. It takes just the
+// space of the entries, with no allocation or hashing per entry.
+//
+// New entries go to an unsorted tail, which lookups scan, and which is sorted
+// and merged into the rest once that gets costly. So a map can be built in
+// any order while being looked up. Erased entries are only marked as such
+// until a merge.
+//
+// Lookups may do that merging, so unlike std::map they are not const.
+//
+
+#ifndef wasm_support_sorted_map_h
+#define wasm_support_sorted_map_h
+
+#include <algorithm>
+#include <vector>
+
+namespace wasm {
+
+template<typename Key, typename T>
+class SortedMap {
+  struct Entry {
+    Key key;
+    T value;
+    bool erased; // fits in the padding of the usual small entries
+
+    bool operator<(const Entry& other) const { return key < other.key; }
+  };
+
+  std::vector<Entry> entries;
+  size_t numSorted = 0; // the entries before this are sorted
+  size_t numErased = 0;
+  size_t scanned = 0; // how much of the tail lookups scanned since a merge
+
+  static const size_t MinScan = 16;
+
+  // Finds an entry, erased or not. The tail is merged once scanning it cost
+  // about as much as a merge does.
+  Entry* find(Key key) {
+    size_t tail = entries.size() - numSorted;
+    if (tail > 0) {
+      scanned += tail;
+      if (scanned > numSorted + MinScan) merge();
+    }
+    auto sortedEnd = entries.begin() + numSorted;
+    auto iter = std::lower_bound(entries.begin(), sortedEnd, Entry{ key, T(), false });
+    if (iter != sortedEnd && iter->key == key) return &*iter;
+    for (auto i = sortedEnd; i != entries.end(); ++i) {
+      if (i->key == key) return &*i;
+    }
+    return nullptr;
+  }
+
+  void merge() {
+    auto sortedEnd = entries.begin() + numSorted;
+    std::sort(sortedEnd, entries.end());
+    std::inplace_merge(entries.begin(), sortedEnd, entries.end());
+    if (numErased * 4 > entries.size()) {
+      entries.erase(std::remove_if(entries.begin(), entries.end(), [](const Entry& entry) {
+        return entry.erased;
+      }), entries.end());
+      numErased = 0;
+    }
+    numSorted = entries.size();
+    scanned = 0;
+  }
+
+public:
+  size_t size() const {
+    return entries.size() - numErased;
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  // Returns the value for a key, or null if there is none.
+  T* get(Key key) {
+    auto* entry = find(key);
+    return entry && !entry->erased ? &entry->value : nullptr;
+  }
+
+  bool has(Key key) {
+    return get(key) != nullptr;
+  }
+
+  void set(Key key, const T& value) {
+    if (auto* entry = find(key)) {
+      if (entry->erased) {
+        entry->erased = false;
+        numErased--;
+      }
+      entry->value = value;
+      return;
+    }
+    entries.push_back(Entry{ key, value, false });
+  }
+
+  // Returns whether the key was present.
+  bool erase(Key key) {
+    auto* entry = find(key);
+    if (!entry || entry->erased) return false;
+    if (size_t(entry - entries.data()) >= numSorted) {
+      *entry = entries.back();
+      entries.pop_back();
+    } else {
+      entry->erased = true;
+      numErased++;
+    }
+    return true;
+  }
+
+  // Calls func(key, value) for each entry, in order of the keys.
+  template<typename F>
+  void forEach(F func) {
+    merge();
+    for (auto& entry : entries) {
+      if (!entry.erased) func(entry.key, entry.value);
+    }
+  }
+
+  void reserve(size_t size) {
+    entries.reserve(size);
+  }
+
+  void clear() {
+    entries.clear();
+    numSorted = numErased = scanned = 0;
+  }
+
+  void swap(SortedMap& other) {
+    entries.swap(other.entries);
+    std::swap(numSorted, other.numSorted);
+    std::swap(numErased, other.numErased);
+    std::swap(scanned, other.scanned);
+  }
+};
+
+} // namespace wasm
+
+#endif // wasm_support_sorted_map_h
@@ -0,0 +1,37 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sstream>
+
+#include "support/text-writer.h"
+#include "support/colors.h"
+
+namespace wasm {
+
+void TextWriter::color(void (*setColor)(std::ostream&)) {
+  if (!Colors::isEnabled()) return;
+#ifdef _WIN32
+  // colors are set on the console, so what is before them must get there first
+  flush();
+  if (out) setColor(*out);
+#else
+  std::ostringstream code;
+  setColor(code);
+  *this << code.str();
+#endif
+}
+
+} // namespace wasm
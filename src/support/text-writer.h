@@ -0,0 +1,127 @@
+/*
+ * Copyright 2017 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// A buffered writer for text made of many small pieces, like the text
+// format. Writing through an std::ostream costs a sentry, a virtual call and,
+// for numbers, locale-aware formatting for each piece; here pieces are
+// appended to a buffer, and numbers are formatted by hand.
+//
+// A writer either flushes to an ostream as it goes, or keeps everything for
+// str().
+//
+
+#ifndef wasm_support_text_writer_h
+#define wasm_support_text_writer_h
+
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace wasm {
+
+class TextWriter {
+  std::string buffer;
+  std::ostream* out = nullptr;
+
+  static const size_t FlushSize = 1 << 16;
+
+  void maybeFlush() {
+    if (buffer.size() >= FlushSize) flush();
+  }
+
+public:
+  TextWriter() {}
+  explicit TextWriter(std::ostream& out) : out(&out) {}
+  ~TextWriter() { flush(); }
+
+  TextWriter(const TextWriter&) = delete;
+  TextWriter& operator=(const TextWriter&) = delete;
+
+  void flush() {
+    if (out && !buffer.empty()) {
+      out->write(buffer.data(), buffer.size());
+      buffer.clear();
+    }
+  }
+
+  // What was written, if there is no ostream
+  std::string& str() { return buffer; }
+
+  void write(const char* data, size_t size) {
+    buffer.append(data, size);
+    maybeFlush();
+  }
+
+  TextWriter& operator<<(char c) {
+    buffer.push_back(c);
+    maybeFlush();
+    return *this;
+  }
+  // like an ostream, these are characters, not numbers
+  TextWriter& operator<<(unsigned char c) { return *this << char(c); }
+  TextWriter& operator<<(signed char c) { return *this << char(c); }
+  TextWriter& operator<<(const char* str) {
+    write(str, strlen(str));
+    return *this;
+  }
+  TextWriter& operator<<(const std::string& str) {
+    write(str.data(), str.size());
+    return *this;
+  }
+
+  // Integers are written in decimal, like an ostream with default flags.
+  TextWriter& operator<<(unsigned long long x) {
+    char digits[20];
+    char* start = digits + sizeof(digits);
+    do {
+      *--start = '0' + x % 10;
+      x /= 10;
+    } while (x);
+    write(start, digits + sizeof(digits) - start);
+    return *this;
+  }
+  TextWriter& operator<<(long long x) {
+    if (x < 0) {
+      buffer.push_back('-');
+      return *this << (0ULL - (unsigned long long)x);
+    }
+    return *this << (unsigned long long)x;
+  }
+  TextWriter& operator<<(unsigned long x) { return *this << (unsigned long long)x; }
+  TextWriter& operator<<(long x) { return *this << (long long)x; }
+  TextWriter& operator<<(unsigned x) { return *this << (unsigned long long)x; }
+  TextWriter& operator<<(int x) { return *this << (long long)x; }
+
+  // Writes in lowercase hex, like an ostream with std::hex.
+  void writeHex(uint64_t x) {
+    char digits[16];
+    char* start = digits + sizeof(digits);
+    do {
+      *--start = "0123456789abcdef"[x & 15];
+      x >>= 4;
+    } while (x);
+    write(start, digits + sizeof(digits) - start);
+  }
+
+  // Writes a color, given one of the functions in Colors.
+  void color(void (*setColor)(std::ostream&));
+};
+
+} // namespace wasm
+
+#endif // wasm_support_text_writer_h
@@ -63,7 +63,6 @@ Thread::~Thread() {
 }
 
 void Thread::work(std::function<ThreadWorkState ()> doWork_) {
-  // TODO: fancy work stealing
   DEBUG_THREAD("send work to thread\n");
   {
     std::lock_guard<std::mutex> lock(mutex);
@@ -149,7 +148,6 @@ void ThreadPool::work(std::vector<std::function<ThreadWorkState ()>>& doWorkers)
     return;
   }
   // run in parallel on threads
-  // TODO: fancy work stealing
   DEBUG_POOL("work() on threads\n");
   assert(doWorkers.size() == num);
   assert(!running);
@@ -193,5 +191,51 @@ bool ThreadPool::areThreadsReady() {
   return ready.load() == threads.size();
 }
 
+// WorkStealingScheduler
+
+WorkStealingScheduler::WorkStealingScheduler(size_t numWorkers, const std::vector<size_t>& costs) {
+  assert(numWorkers > 0);
+  for (size_t i = 0; i < numWorkers; i++) {
+    queues.emplace_back(make_unique<WorkerQueue>());
+  }
+  // largest first, dealt out round-robin so each worker starts on a big one
+  std::vector<size_t> order;
+  order.reserve(costs.size());
+  for (size_t i = 0; i < costs.size(); i++) {
+    order.push_back(i);
+  }
+  std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return costs[a] > costs[b];
+  });
+  for (size_t i = 0; i < order.size(); i++) {
+    queues[i % numWorkers]->tasks.push_back(order[i]);
+  }
+}
+
+bool WorkStealingScheduler::getTask(size_t worker, size_t& task) {
+  assert(worker < queues.size());
+  {
+    auto& own = *queues[worker];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = own.tasks.front();
+      own.tasks.pop_front();
+      return true;
+    }
+  }
+  // our queue is empty, and nothing is ever added to a queue after
+  // construction, so look for a victim with work left
+  for (size_t i = 1; i < queues.size(); i++) {
+    auto& victim = *queues[(worker + i) % queues.size()];
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = victim.tasks.back();
+      victim.tasks.pop_back();
+      return true;
+    }
+  }
+  return false;
+}
+
 } // namespace wasm
 
@@ -22,7 +22,9 @@
 #define wasm_support_threads_h
 
 #include <atomic>
+#include <cassert>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -106,6 +108,35 @@ private:
   bool areThreadsReady();
 };
 
+//
+// A work-stealing scheduler for a set of indexed tasks, meant to be used
+// from the doWorkers of a ThreadPool::work() call.
+//
+// Tasks are dealt out to per-worker deques in order of decreasing cost, so
+// large tasks are started first. A worker takes tasks from the front of its
+// own deque, and when that is empty it steals from the back of another
+// worker's deque. That way a few large tasks do not leave the other workers
+// idle at the end.
+//
+
+class WorkStealingScheduler {
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<size_t> tasks;
+  };
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues;
+
+public:
+  // Schedules the tasks 0..costs.size()-1 on numWorkers workers. Tasks of
+  // equal cost are handed out in index order.
+  WorkStealingScheduler(size_t numWorkers, const std::vector<size_t>& costs);
+
+  // Gets the next task for a worker, stealing if its own queue is empty.
+  // Returns false when there is no work left anywhere.
+  bool getTask(size_t worker, size_t& task);
+};
+
 // Verify a code segment is only entered once. Usage:
 //    static OnlyOnce onlyOnce;
 //    onlyOnce.verify();
@@ -99,6 +99,7 @@ int main(int argc, const char *argv[]) {
   }
 
   if (options.debug) std::cerr << "binarification..." << std::endl;
+  Output output(options.extra["output"], Flags::Binary, options.debug ? Flags::Debug : Flags::Release);
   BufferWithRandomAccess buffer(options.debug);
   WasmBinaryWriter writer(&wasm, buffer, options.debug);
   // if debug info is used, then we want to emit the names section
@@ -110,10 +111,10 @@ int main(int argc, const char *argv[]) {
     writer.setSourceMap(sourceMapStream.get(), sourceMapUrl);
   }
   if (symbolMap.size() > 0) writer.setSymbolMap(symbolMap);
+  writer.setOutputStream(&output.getStream());
   writer.write();
 
   if (options.debug) std::cerr << "writing to output..." << std::endl;
-  Output output(options.extra["output"], Flags::Binary, options.debug ? Flags::Debug : Flags::Release);
   buffer.writeTo(output);
   if (sourceMapStream) {
     sourceMapStream->close();
@@ -45,13 +45,13 @@ int main(int argc, const char *argv[]) {
                       });
   options.parse(argc, argv);
 
-  auto input(read_file<std::vector<char>>(options.extra["infile"], Flags::Binary, options.debug ? Flags::Debug : Flags::Release));
+  MappedFile input(options.extra["infile"], options.debug ? Flags::Debug : Flags::Release);
 
   if (options.debug) std::cerr << "parsing binary..." << std::endl;
   Module wasm;
   try {
     std::unique_ptr<std::ifstream> sourceMapStream;
-    WasmBinaryBuilder parser(wasm, input, options.debug);
+    WasmBinaryBuilder parser(wasm, input.data(), input.size(), options.debug);
     if (sourceMapFilename.size()) {
         sourceMapStream = make_unique<std::ifstream>();
         sourceMapStream->open(sourceMapFilename);
@@ -98,6 +98,7 @@ int main(int argc, const char* argv[]) {
   bool emitBinary = true;
   bool debugInfo = false;
   bool fuzzExec = false;
+  bool lazy = false;
 
   OptimizationOptions options("wasm-opt", "Optimize .wast files");
   options
@@ -116,6 +117,15 @@ int main(int argc, const char* argv[]) {
       .add("--fuzz-exec", "-fe", "Execute functions before and after optimization, helping fuzzing find bugs",
            Options::Arguments::Zero,
            [&](Options *o, const std::string &arguments) { fuzzExec = true; })
+      .add("--reclaim-memory", "-rm", "Free the memory that passes allocate as they go, by moving each function into fresh memory after its passes (helps long pass pipelines)",
+           Options::Arguments::Zero,
+           [&](Options *o, const std::string &arguments) { options.passOptions.reclaimMemory = true; })
+      .add("--lazy-function-bodies", "-lz", "Decode function bodies only when they are needed, and write out the ones that never are as they were read (helps when only some functions are touched, as in --remove-unused-module-elements)",
+           Options::Arguments::Zero,
+           [&](Options *o, const std::string &arguments) { lazy = true; })
+      .add("--function-cache", "-fc", "Cache the results of optimizing each function in a directory, and reuse them for functions that did not change since an earlier run",
+           Options::Arguments::One,
+           [&](Options *o, const std::string &argument) { options.passOptions.cacheDirectory = argument; })
       .add_positional("INFILE", Options::Arguments::One,
                       [](Options* o, const std::string& argument) {
                         o->extra["infile"] = argument;
@@ -130,6 +140,7 @@ int main(int argc, const char* argv[]) {
     if (options.debug) std::cerr << "reading...\n";
     ModuleReader reader;
     reader.setDebug(options.debug);
+    reader.setLazy(lazy);
 
     try {
       reader.read(options.extra["infile"], wasm);
@@ -22,6 +22,7 @@
 #define wasm_wasm_binary_h
 
 #include <cassert>
+#include <mutex>
 #include <ostream>
 #include <type_traits>
 
@@ -79,7 +80,11 @@ struct LEB {
     } while (more);
   }
 
-  void read(std::function<MiniT()> get) {
+  // get is called for each byte. it is a template parameter rather than
+  // a std::function so that it can be inlined, which matters as LEBs are
+  // by far the most common thing in the binary format.
+  template<typename Get>
+  void read(Get get) {
     value = 0;
     T shift = 0;
     MiniT byte;
@@ -611,6 +616,8 @@ inline S32LEB binaryWasmType(WasmType type) {
   return S32LEB(ret);
 }
 
+class WasmBinaryLazyDecoder;
+
 class WasmBinaryWriter : public Visitor<WasmBinaryWriter, void> {
   Module* wasm;
   BufferWithRandomAccess& o;
@@ -620,6 +627,12 @@ class WasmBinaryWriter : public Visitor<WasmBinaryWriter, void> {
   std::ostream* sourceMap = nullptr;
   std::string sourceMapUrl;
   std::string symbolMap;
+  bool compactSizes = true;
+  std::ostream* outputStream = nullptr;
+  size_t flushed = 0; // bytes already written out to outputStream
+
+  // positions of the size placeholders written in the current section
+  std::vector<size_t> sizePlaceholders;
 
   MixedArena allocator;
 
@@ -629,12 +642,26 @@ public:
     prepare();
   }
 
+  // A writer for encoding function bodies on another thread, into another
+  // buffer, with the same index mappings as the parent.
+  WasmBinaryWriter(WasmBinaryWriter& parent, BufferWithRandomAccess& o) : wasm(parent.wasm), o(o), debug(false), mappedFunctions(parent.mappedFunctions), mappedGlobals(parent.mappedGlobals), copyableLazyBodies(parent.copyableLazyBodies) {}
+
   void setNamesSection(bool set) { debugInfo = set; }
   void setSourceMap(std::ostream* set, std::string url) {
     sourceMap = set;
     sourceMapUrl = url;
   }
   void setSymbolMap(std::string set) { symbolMap = set; }
+  // Sizes of sections and function bodies are not known until they have been
+  // written, so they get padded 5-byte LEB placeholders that are backpatched.
+  // By default each section is then compacted so that its sizes use as few
+  // bytes as possible. That is not done when emitting a source map, whose
+  // offsets must not move.
+  void setCompactSizes(bool set) { compactSizes = set; }
+  // Write each section out to a stream as soon as it is finished, so that
+  // only the section being built is kept in the buffer, instead of the
+  // whole binary.
+  void setOutputStream(std::ostream* set) { outputStream = set; }
 
   void write();
   void writeHeader();
@@ -642,6 +669,10 @@ public:
   void writeResizableLimits(Address initial, Address maximum, bool hasMaximum, bool shared);
   int32_t startSection(BinaryConsts::Section code);
   void finishSection(int32_t start);
+  void compactSection(size_t start);
+  bool shouldCompactSizes();
+  bool isStreaming();
+  void flush();
   int32_t startSubsection(BinaryConsts::UserSections::Subsection code);
   void finishSubsection(int32_t start);
   void writeStart();
@@ -657,15 +688,23 @@ public:
   void writeFunctionSignatures();
   void writeExpression(Expression* curr);
   void writeFunctions();
+  void writeFunctionsInParallel();
+  void writeFunctionBody(Function* function);
   void writeGlobals();
   void writeExports();
   void writeDataSegments();
+  void writeDataSegmentsToStream(uint32_t num);
 
   std::map<Name, Index> mappedFunctions; // name of the Function => index. first imports, then internals
   std::map<Name, uint32_t> mappedGlobals; // name of the Global => index. first imported globals, then internal globals
   uint32_t getFunctionIndex(Name name);
   uint32_t getGlobalIndex(Name name);
 
+  // lazily-read bodies that were never decoded are copied as they were read,
+  // if the module's index spaces still match the binary's
+  std::map<LazyFunctionDecoder*, bool> copyableLazyBodies;
+  bool canCopyLazyBodies(WasmBinaryLazyDecoder* decoder);
+
   void writeFunctionTableDeclaration();
   void writeTableElements();
   void writeNames();
@@ -704,10 +743,9 @@ public:
   void visit(Expression* curr) {
     if (sourceMap && currFunction) {
       // Dump the sourceMap debug info
-      auto& debugLocations = currFunction->debugLocations;
-      auto iter = debugLocations.find(curr);
-      if (iter != debugLocations.end() && iter->second != lastDebugLocation) {
-        writeDebugLocation(o.size(), iter->second);
+      auto* location = currFunction->debugLocations.get(curr);
+      if (location && *location != lastDebugLocation) {
+        writeDebugLocation(flushed + o.size(), *location);
       }
     }
     Visitor<WasmBinaryWriter>::visit(curr);
@@ -747,7 +785,8 @@ public:
 class WasmBinaryBuilder {
   Module& wasm;
   MixedArena& allocator;
-  std::vector<char>& input;
+  const char* input; // not owned, and must outlive us
+  size_t inputSize;
   bool debug;
   std::istream* sourceMap;
   std::pair<uint32_t, Function::DebugLocation> nextDebugLocation;
@@ -758,12 +797,29 @@ class WasmBinaryBuilder {
 
   std::set<BinaryConsts::Section> seenSections;
 
+  bool lazy = false;
+  std::shared_ptr<void> lazyInput;
+  std::shared_ptr<WasmBinaryLazyDecoder> lazyDecoder;
+
 public:
-  WasmBinaryBuilder(Module& wasm, std::vector<char>& input, bool debug) : wasm(wasm), allocator(wasm.allocator), input(input), debug(debug), sourceMap(nullptr), nextDebugLocation(0, { 0, 0, 0 }), useDebugLocation(false) {}
+  WasmBinaryBuilder(Module& wasm, const char* input, size_t inputSize, bool debug) : wasm(wasm), allocator(wasm.allocator), input(input), inputSize(inputSize), debug(debug), sourceMap(nullptr), nextDebugLocation(0, { 0, 0, 0 }), useDebugLocation(false) {}
+  WasmBinaryBuilder(Module& wasm, const std::vector<char>& input, bool debug) : WasmBinaryBuilder(wasm, input.data(), input.size(), debug) {}
+
+  // A builder for decoding function bodies on another thread, with the
+  // state of the parent that function bodies refer to.
+  WasmBinaryBuilder(WasmBinaryBuilder& parent) : wasm(parent.wasm), allocator(parent.allocator), input(parent.input), inputSize(parent.inputSize), debug(false), sourceMap(nullptr), nextDebugLocation(0, { 0, 0, 0 }), useDebugLocation(false), functionImportIndexes(parent.functionImportIndexes), functionTypes(parent.functionTypes), mappedGlobals(parent.mappedGlobals) {}
+
+  // Do not decode function bodies while reading, only when they are needed,
+  // see Function::isLazy(). The functions keep pointers into the input, so
+  // they keep inputOwner alive, which must own it.
+  void setLazy(std::shared_ptr<void> inputOwner) {
+    lazy = true;
+    lazyInput = inputOwner;
+  }
 
   void read();
   void readUserSection(size_t payloadLen);
-  bool more() { return pos < input.size();}
+  bool more() { return pos < inputSize;}
 
   uint8_t getInt8();
   uint16_t getInt16();
@@ -812,6 +868,12 @@ public:
   Index endOfFunction = -1; // before we see a function (like global init expressions), there is no end of function to check
 
   void readFunctions();
+  void readFunctionsInParallel(size_t total);
+  void readFunctionsLazily(size_t total);
+  Function* readFunction(Index i, size_t size); // reads the body at pos
+  Function* readFunctionHeader(Index i, size_t size); // reads the signature and locals at pos
+  void readFunctionBody(Function* func); // reads the code after the header
+  void decodeLazyFunction(Function* func, const std::vector<Name>& functionNames);
 
   std::map<Export*, Index> exportIndexes;
   std::vector<Export*> exportOrder;
@@ -903,6 +965,25 @@ public:
   void visitDrop(Drop *curr);
 };
 
+// Decodes the bodies of the functions that a WasmBinaryBuilder read lazily.
+// Bodies refer to other module elements by their index in the binary, so
+// elements must not be removed or reordered while bodies that may refer to
+// them are not decoded yet.
+class WasmBinaryLazyDecoder : public LazyFunctionDecoder {
+  std::shared_ptr<void> inputOwner;
+  std::unique_ptr<WasmBinaryBuilder> prototype; // the reader state that bodies refer to
+  std::mutex mutex;
+  std::vector<std::unique_ptr<WasmBinaryBuilder>> idle; // builders not decoding on any thread
+
+public:
+  // the index spaces of the binary, imports first
+  std::vector<Name> functionNames, globalNames, typeNames;
+
+  WasmBinaryLazyDecoder(WasmBinaryBuilder& parent, std::shared_ptr<void> inputOwner) : inputOwner(inputOwner), prototype(new WasmBinaryBuilder(parent)) {}
+
+  void decode(Function* func) override;
+};
+
 } // namespace wasm
 
 #endif // wasm_wasm_binary_h
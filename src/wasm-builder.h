@@ -36,6 +36,13 @@ struct NameType {
 class Builder {
   MixedArena& allocator;
 
+  // allocates a node, reusing the memory of a recycled one if possible
+  // (see ExpressionManipulator::recycle)
+  template<class T>
+  T* alloc() {
+    return allocator.alloc<T>(T::SpecificId);
+  }
+
 public:
   Builder(MixedArena& allocator) : allocator(allocator) {}
   Builder(Module& wasm) : allocator(wasm.allocator) {}
@@ -67,10 +74,10 @@ public:
   }
 
   Nop* makeNop() {
-    return allocator.alloc<Nop>();
+    return alloc<Nop>();
   }
   Block* makeBlock(Expression* first = nullptr) {
-    auto* ret = allocator.alloc<Block>();
+    auto* ret = alloc<Block>();
     if (first) {
       ret->list.push_back(first);
       ret->finalize();
@@ -83,39 +90,39 @@ public:
     return ret;
   }
   If* makeIf(Expression* condition, Expression* ifTrue, Expression* ifFalse = nullptr) {
-    auto* ret = allocator.alloc<If>();
+    auto* ret = alloc<If>();
     ret->condition = condition; ret->ifTrue = ifTrue; ret->ifFalse = ifFalse;
     ret->finalize();
     return ret;
   }
   Loop* makeLoop(Name name, Expression* body) {
-    auto* ret = allocator.alloc<Loop>();
+    auto* ret = alloc<Loop>();
     ret->name = name; ret->body = body;
     ret->finalize();
     return ret;
   }
   Break* makeBreak(Name name, Expression* value = nullptr, Expression* condition = nullptr) {
-    auto* ret = allocator.alloc<Break>();
+    auto* ret = alloc<Break>();
     ret->name = name; ret->value = value; ret->condition = condition;
     ret->finalize();
     return ret;
   }
   template<typename T>
   Switch* makeSwitch(T& list, Name default_, Expression* condition, Expression* value = nullptr) {
-    auto* ret = allocator.alloc<Switch>();
+    auto* ret = alloc<Switch>();
     ret->targets.set(list);
     ret->default_ = default_; ret->value = value; ret->condition = condition;
     return ret;
   }
   Call* makeCall(Name target, const std::vector<Expression*>& args, WasmType type) {
-    auto* call = allocator.alloc<Call>();
+    auto* call = alloc<Call>();
     call->type = type; // not all functions may exist yet, so type must be provided
     call->target = target;
     call->operands.set(args);
     return call;
   }
   CallImport* makeCallImport(Name target, const std::vector<Expression*>& args, WasmType type) {
-    auto* call = allocator.alloc<CallImport>();
+    auto* call = alloc<CallImport>();
     call->type = type; // similar to makeCall, for consistency
     call->target = target;
     call->operands.set(args);
@@ -123,7 +130,7 @@ public:
   }
   template<typename T>
   Call* makeCall(Name target, const T& args, WasmType type) {
-    auto* call = allocator.alloc<Call>();
+    auto* call = alloc<Call>();
     call->type = type; // not all functions may exist yet, so type must be provided
     call->target = target;
     call->operands.set(args);
@@ -131,14 +138,14 @@ public:
   }
   template<typename T>
   CallImport* makeCallImport(Name target, const T& args, WasmType type) {
-    auto* call = allocator.alloc<CallImport>();
+    auto* call = alloc<CallImport>();
     call->type = type; // similar to makeCall, for consistency
     call->target = target;
     call->operands.set(args);
     return call;
   }
   CallIndirect* makeCallIndirect(FunctionType* type, Expression* target, const std::vector<Expression*>& args) {
-    auto* call = allocator.alloc<CallIndirect>();
+    auto* call = alloc<CallIndirect>();
     call->fullType = type->name;
     call->type = type->result;
     call->target = target;
@@ -146,7 +153,7 @@ public:
     return call;
   }
   CallIndirect* makeCallIndirect(Name fullType, Expression* target, const std::vector<Expression*>& args, WasmType type) {
-    auto* call = allocator.alloc<CallIndirect>();
+    auto* call = alloc<CallIndirect>();
     call->fullType = fullType;
     call->type = type;
     call->target = target;
@@ -155,39 +162,39 @@ public:
   }
   // FunctionType
   GetLocal* makeGetLocal(Index index, WasmType type) {
-    auto* ret = allocator.alloc<GetLocal>();
+    auto* ret = alloc<GetLocal>();
     ret->index = index;
     ret->type = type;
     return ret;
   }
   SetLocal* makeSetLocal(Index index, Expression* value) {
-    auto* ret = allocator.alloc<SetLocal>();
+    auto* ret = alloc<SetLocal>();
     ret->index = index;
     ret->value = value;
     ret->type = none;
     return ret;
   }
   SetLocal* makeTeeLocal(Index index, Expression* value) {
-    auto* ret = allocator.alloc<SetLocal>();
+    auto* ret = alloc<SetLocal>();
     ret->index = index;
     ret->value = value;
     ret->type = value->type;
     return ret;
   }
   GetGlobal* makeGetGlobal(Name name, WasmType type) {
-    auto* ret = allocator.alloc<GetGlobal>();
+    auto* ret = alloc<GetGlobal>();
     ret->name = name;
     ret->type = type;
     return ret;
   }
   SetGlobal* makeSetGlobal(Name name, Expression* value) {
-    auto* ret = allocator.alloc<SetGlobal>();
+    auto* ret = alloc<SetGlobal>();
     ret->name = name;
     ret->value = value;
     return ret;
   }
   Load* makeLoad(unsigned bytes, bool signed_, uint32_t offset, unsigned align, Expression *ptr, WasmType type) {
-    auto* ret = allocator.alloc<Load>();
+    auto* ret = alloc<Load>();
     ret->isAtomic = false;
     ret->bytes = bytes; ret->signed_ = signed_; ret->offset = offset; ret->align = align; ret->ptr = ptr;
     ret->type = type;
@@ -199,7 +206,7 @@ public:
     return load;
   }
   Store* makeStore(unsigned bytes, uint32_t offset, unsigned align, Expression *ptr, Expression *value, WasmType type) {
-    auto* ret = allocator.alloc<Store>();
+    auto* ret = alloc<Store>();
     ret->isAtomic = false;
     ret->bytes = bytes; ret->offset = offset; ret->align = align; ret->ptr = ptr; ret->value = value; ret->valueType = type;
     ret->finalize();
@@ -213,7 +220,7 @@ public:
   }
   AtomicRMW* makeAtomicRMW(AtomicRMWOp op, unsigned bytes, uint32_t offset,
                            Expression* ptr, Expression* value, WasmType type) {
-    auto* ret = allocator.alloc<AtomicRMW>();
+    auto* ret = alloc<AtomicRMW>();
     ret->op = op;
     ret->bytes = bytes;
     ret->offset = offset;
@@ -226,7 +233,7 @@ public:
   AtomicCmpxchg* makeAtomicCmpxchg(unsigned bytes, uint32_t offset,
                                    Expression* ptr, Expression* expected,
                                    Expression* replacement, WasmType type) {
-    auto* ret = allocator.alloc<AtomicCmpxchg>();
+    auto* ret = alloc<AtomicCmpxchg>();
     ret->bytes = bytes;
     ret->offset = offset;
     ret->ptr = ptr;
@@ -238,36 +245,36 @@ public:
   }
   Const* makeConst(Literal value) {
     assert(isConcreteWasmType(value.type));
-    auto* ret = allocator.alloc<Const>();
+    auto* ret = alloc<Const>();
     ret->value = value;
     ret->type = value.type;
     return ret;
   }
   Unary* makeUnary(UnaryOp op, Expression *value) {
-    auto* ret = allocator.alloc<Unary>();
+    auto* ret = alloc<Unary>();
     ret->op = op; ret->value = value;
     ret->finalize();
     return ret;
   }
   Binary* makeBinary(BinaryOp op, Expression *left, Expression *right) {
-    auto* ret = allocator.alloc<Binary>();
+    auto* ret = alloc<Binary>();
     ret->op = op; ret->left = left; ret->right = right;
     ret->finalize();
     return ret;
   }
   Select* makeSelect(Expression* condition, Expression *ifTrue, Expression *ifFalse) {
-    auto* ret = allocator.alloc<Select>();
+    auto* ret = alloc<Select>();
     ret->condition = condition; ret->ifTrue = ifTrue; ret->ifFalse = ifFalse;
     ret->finalize();
     return ret;
   }
   Return* makeReturn(Expression *value = nullptr) {
-    auto* ret = allocator.alloc<Return>();
+    auto* ret = alloc<Return>();
     ret->value = value;
     return ret;
   }
   Host* makeHost(HostOp op, Name nameOperand, std::vector<Expression*>&& operands) {
-    auto* ret = allocator.alloc<Host>();
+    auto* ret = alloc<Host>();
     ret->op = op;
     ret->nameOperand = nameOperand;
     ret->operands.set(operands);
@@ -275,13 +282,13 @@ public:
     return ret;
   }
   Unreachable* makeUnreachable() {
-    return allocator.alloc<Unreachable>();
+    return alloc<Unreachable>();
   }
 
   // Additional helpers
 
   Drop* makeDrop(Expression *value) {
-    auto* ret = allocator.alloc<Drop>();
+    auto* ret = alloc<Drop>();
     ret->value = value;
     ret->finalize();
     return ret;
@@ -367,7 +374,7 @@ public:
       // just one
       ret = input->list[from];
     } else {
-      auto* block = allocator.alloc<Block>();
+      auto* block = alloc<Block>();
       for (Index i = from; i < to; i++) {
         block->list.push_back(input->list[i]);
       }
@@ -378,7 +385,7 @@ public:
       input->list.resize(from);
     } else {
       for (Index i = from; i < to; i++) {
-        input->list[i] = allocator.alloc<Nop>();
+        input->list[i] = alloc<Nop>();
       }
     }
     input->finalize();
@@ -118,6 +118,12 @@ template<typename SubType>
 class ExpressionRunner : public Visitor<SubType, Flow> {
 public:
   Flow visit(Expression *curr) {
+    return static_cast<SubType*>(this)->evaluate(curr);
+  }
+
+  // Every expression is run through here, children included, so a runner
+  // can override this to handle some before they are visited.
+  Flow evaluate(Expression *curr) {
     return Visitor<SubType, Flow>::visit(curr);
   }
 
@@ -326,21 +332,21 @@ public:
         case SubInt32:      return left.sub(right);
         case MulInt32:      return left.mul(right);
         case DivSInt32: {
-          if (right.getInteger() == 0) trap("i32.div_s by 0");
-          if (left.getInteger() == std::numeric_limits<int32_t>::min() && right.getInteger() == -1) trap("i32.div_s overflow"); // signed division overflow
+          if (right.getInteger() == 0) return trap("i32.div_s by 0");
+          if (left.getInteger() == std::numeric_limits<int32_t>::min() && right.getInteger() == -1) return trap("i32.div_s overflow"); // signed division overflow
           return left.divS(right);
         }
         case DivUInt32: {
-          if (right.getInteger() == 0) trap("i32.div_u by 0");
+          if (right.getInteger() == 0) return trap("i32.div_u by 0");
           return left.divU(right);
         }
         case RemSInt32: {
-          if (right.getInteger() == 0) trap("i32.rem_s by 0");
+          if (right.getInteger() == 0) return trap("i32.rem_s by 0");
           if (left.getInteger() == std::numeric_limits<int32_t>::min() && right.getInteger() == -1) return Literal(int32_t(0));
           return left.remS(right);
         }
         case RemUInt32: {
-          if (right.getInteger() == 0) trap("i32.rem_u by 0");
+          if (right.getInteger() == 0) return trap("i32.rem_u by 0");
           return left.remU(right);
         }
         case AndInt32:  return left.and_(right);
@@ -369,21 +375,21 @@ public:
         case SubInt64:      return left.sub(right);
         case MulInt64:      return left.mul(right);
         case DivSInt64: {
-          if (right.getInteger() == 0) trap("i64.div_s by 0");
-          if (left.getInteger() == LLONG_MIN && right.getInteger() == -1LL) trap("i64.div_s overflow"); // signed division overflow
+          if (right.getInteger() == 0) return trap("i64.div_s by 0");
+          if (left.getInteger() == LLONG_MIN && right.getInteger() == -1LL) return trap("i64.div_s overflow"); // signed division overflow
           return left.divS(right);
         }
         case DivUInt64: {
-          if (right.getInteger() == 0) trap("i64.div_u by 0");
+          if (right.getInteger() == 0) return trap("i64.div_u by 0");
           return left.divU(right);
         }
         case RemSInt64: {
-          if (right.getInteger() == 0) trap("i64.rem_s by 0");
+          if (right.getInteger() == 0) return trap("i64.rem_s by 0");
           if (left.getInteger() == LLONG_MIN && right.getInteger() == -1LL) return Literal(int64_t(0));
           return left.remS(right);
         }
         case RemUInt64: {
-          if (right.getInteger() == 0) trap("i64.rem_u by 0");
+          if (right.getInteger() == 0) return trap("i64.rem_u by 0");
           return left.remU(right);
         }
         case AndInt64:  return left.and_(right);
@@ -460,51 +466,52 @@ public:
   }
   Flow visitUnreachable(Unreachable *curr) {
     NOTE_ENTER("Unreachable");
-    trap("unreachable");
-    return Flow();
+    return trap("unreachable");
   }
 
-  Literal truncSFloat(Unary* curr, Literal value) {
+  Flow truncSFloat(Unary* curr, Literal value) {
     double val = value.getFloat();
-    if (std::isnan(val)) trap("truncSFloat of nan");
+    if (std::isnan(val)) return trap("truncSFloat of nan");
     if (curr->type == i32) {
       if (value.type == f32) {
-        if (!isInRangeI32TruncS(value.reinterpreti32())) trap("i32.truncSFloat overflow");
+        if (!isInRangeI32TruncS(value.reinterpreti32())) return trap("i32.truncSFloat overflow");
       } else {
-        if (!isInRangeI32TruncS(value.reinterpreti64())) trap("i32.truncSFloat overflow");
+        if (!isInRangeI32TruncS(value.reinterpreti64())) return trap("i32.truncSFloat overflow");
       }
       return Literal(int32_t(val));
     } else {
       if (value.type == f32) {
-        if (!isInRangeI64TruncS(value.reinterpreti32())) trap("i64.truncSFloat overflow");
+        if (!isInRangeI64TruncS(value.reinterpreti32())) return trap("i64.truncSFloat overflow");
       } else {
-        if (!isInRangeI64TruncS(value.reinterpreti64())) trap("i64.truncSFloat overflow");
+        if (!isInRangeI64TruncS(value.reinterpreti64())) return trap("i64.truncSFloat overflow");
       }
       return Literal(int64_t(val));
     }
   }
 
-  Literal truncUFloat(Unary* curr, Literal value) {
+  Flow truncUFloat(Unary* curr, Literal value) {
     double val = value.getFloat();
-    if (std::isnan(val)) trap("truncUFloat of nan");
+    if (std::isnan(val)) return trap("truncUFloat of nan");
     if (curr->type == i32) {
       if (value.type == f32) {
-        if (!isInRangeI32TruncU(value.reinterpreti32())) trap("i32.truncUFloat overflow");
+        if (!isInRangeI32TruncU(value.reinterpreti32())) return trap("i32.truncUFloat overflow");
       } else {
-        if (!isInRangeI32TruncU(value.reinterpreti64())) trap("i32.truncUFloat overflow");
+        if (!isInRangeI32TruncU(value.reinterpreti64())) return trap("i32.truncUFloat overflow");
       }
       return Literal(uint32_t(val));
     } else {
       if (value.type == f32) {
-        if (!isInRangeI64TruncU(value.reinterpreti32())) trap("i64.truncUFloat overflow");
+        if (!isInRangeI64TruncU(value.reinterpreti32())) return trap("i64.truncUFloat overflow");
       } else {
-        if (!isInRangeI64TruncU(value.reinterpreti64())) trap("i64.truncUFloat overflow");
+        if (!isInRangeI64TruncU(value.reinterpreti64())) return trap("i64.truncUFloat overflow");
       }
       return Literal(uint64_t(val));
     }
   }
 
-  virtual void trap(const char* why) {
+  // Called when execution traps. A runner that can go on returns the flow
+  // for the trapping expression.
+  virtual Flow trap(const char* why) {
     WASM_UNREACHABLE();
   }
 };
@@ -877,8 +884,9 @@ public:
         }
       }
 
-      void trap(const char* why) override {
+      Flow trap(const char* why) override {
         instance.externalInterface->trap(why);
+        WASM_UNREACHABLE(); // external traps do not return
       }
     };
 
@@ -900,6 +908,7 @@ public:
     }
 #endif
 
+    function->materialize();
     Flow flow = RuntimeExpressionRunner(*this, scope).visit(function->body);
     assert(!flow.breaking() || flow.breakTo == RETURN_FLOW); // cannot still be breaking, it means we missed our stop
     Literal ret = flow.value;
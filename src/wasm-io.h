@@ -35,7 +35,12 @@ public:
 };
 
 class ModuleReader : public ModuleIO {
+  bool lazy = false;
+
 public:
+  // decode binary function bodies only when they are needed
+  void setLazy(bool lazy_) { lazy = lazy_; }
+
   // read text
   void readText(std::string filename, Module& wasm);
   // read binary
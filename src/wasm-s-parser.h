@@ -42,36 +42,41 @@ public:
 // An element in an S-Expression: a list or a string
 //
 class Element {
-  typedef ArenaVector<Element*> List;
-
   bool isList_;
-  List list_;
-  cashew::IString str_;
   bool dollared_;
   bool quoted_;
+  // identifiers are interned. numbers and quoted strings are not, as they
+  // are rarely needed as names, and there are many of them
+  bool interned_;
+  uint32_t size_;
+  union {
+    Element** items_; // for a list, in the arena of the parser
+    const char* chars_; // for a string
+  };
 
 public:
-  Element(MixedArena& allocator) : isList_(true), list_(allocator), line(-1), col(-1), loc(nullptr) {}
+  Element(MixedArena& allocator) : isList_(true), size_(0), items_(nullptr), line(-1), col(-1), loc(nullptr) {}
 
   bool isList() const { return isList_; }
   bool isStr() const { return !isList_; }
   bool dollared() const { return isStr() && dollared_; }
   bool quoted() const { return isStr() && quoted_; }
 
-  size_t line, col;
+  uint32_t line, col;
   SourceLocation* loc;
 
   // list methods
-  List& list();
   Element* operator[](unsigned i);
-  size_t size() {
-    return list().size();
-  }
+  size_t size();
+  // the items must outlive this
+  void setList(Element** items, size_t size);
 
-  // string methods
+  // string methods. str() interns the string if it was not already
   cashew::IString str() const;
   const char* c_str() const;
   Element* setString(cashew::IString str__, bool dollared__, bool quoted__);
+  // sets a string that is not interned. the characters must outlive this
+  Element* setRawString(const char* chars__, bool dollared__, bool quoted__);
   Element* setMetadata(size_t line_, size_t col_, SourceLocation* loc_);
 
   // printing
@@ -100,6 +105,7 @@ private:
   void skipWhitespace();
   void parseDebugLocation();
   Element* parseString();
+  Element* parseQuotedString(bool dollared);
 };
 
 //
@@ -121,14 +127,32 @@ public:
   SExpressionWasmBuilder(Module& wasm, Element& module, Name* moduleName = nullptr);
 
 private:
+  // A builder for parsing function bodies on a worker thread, sharing what
+  // the parent found out about the module
+  SExpressionWasmBuilder(SExpressionWasmBuilder& parent);
+
   // pre-parse types and function definitions, so we know function return types before parsing their contents
   void preParseFunctionType(Element& s);
   bool isImport(Element& curr);
   void preParseImports(Element& curr);
   void parseModuleElement(Element& curr);
 
+  // function bodies are parsed after the rest of the module, possibly in
+  // parallel, and then added in order
+  struct FunctionToParse {
+    Element* s;
+    size_t i; // where the contents after the names begin
+    Name name;
+  };
+  std::vector<FunctionToParse> functionsToParse;
+  void parseFunctionBodies();
+
   // function parsing state
   std::unique_ptr<Function> currFunction;
+  // the debug info files the current function refers to, in order of first
+  // use. its debug locations are indexes in this until it is added
+  std::vector<cashew::IString> currDebugInfoFiles;
+  std::unordered_map<cashew::IString, Index> currDebugInfoFileIndices;
   std::map<Name, WasmType> currLocalTypes;
   size_t localIndex; // params and vars
   size_t otherIndex;
@@ -144,6 +168,10 @@ private:
   // returns the next index in s
   size_t parseFunctionNames(Element& s, Name& name, Name& exportName);
   void parseFunction(Element& s, bool preParseImport = false);
+  // returns the function, unless it is an import
+  std::unique_ptr<Function> parseFunctionBody(Element& s, size_t i, Name name, bool preParseImport);
+  void resetFunctionState();
+  void addFunction(std::unique_ptr<Function> func, std::vector<cashew::IString>& debugInfoFiles, Element& s);
 
   WasmType stringToWasmType(cashew::IString str, bool allowError=false, bool prefix=false) {
     return stringToWasmType(str.str, allowError, prefix);
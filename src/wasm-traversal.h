@@ -192,6 +192,7 @@ struct Walker : public VisitorType {
   }
 
   void walkFunction(Function* func) {
+    func->materialize();
     setFunction(func);
     static_cast<SubType*>(this)->doWalkFunction(func);
     static_cast<SubType*>(this)->visitFunction(func);
@@ -199,6 +200,7 @@ struct Walker : public VisitorType {
   }
 
   void walkFunctionInModule(Function* func, Module* module) {
+    func->materialize();
     setModule(module);
     setFunction(func);
     static_cast<SubType*>(this)->doWalkFunction(func);
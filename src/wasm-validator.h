@@ -104,6 +104,12 @@ public:
     return valid;
   }
 
+  // bodies that were read lazily and never decoded are not validated, as
+  // that would decode them; they are left as they were read
+  void walkFunction(Function* func) {
+    if (!func->isLazy()) PostWalker<WasmValidator>::walkFunction(func);
+  }
+
   // visitors
 
   static void visitPreBlock(WasmValidator* self, Expression** currp) {
@@ -46,12 +46,15 @@
 #include <algorithm>
 #include <cassert>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "literal.h"
 #include "mixed_arena.h"
 #include "support/name.h"
+#include "support/name_map.h"
+#include "support/sorted_map.h"
 #include "wasm-type.h"
 
 namespace wasm {
@@ -551,6 +554,23 @@ public:
 
 // Globals
 
+class Function;
+
+// Decodes function bodies that were not decoded when a module was read, see
+// Function::isLazy().
+class LazyFunctionDecoder {
+public:
+  virtual ~LazyFunctionDecoder() {}
+  virtual void decode(Function* func) = 0;
+};
+
+struct LazyFunctionBody {
+  std::shared_ptr<LazyFunctionDecoder> decoder; // shared by the module's lazy functions
+  const char* data; // the original encoding of the body, local declarations included
+  size_t size;
+  Index index; // of the function among the defined functions of the binary
+};
+
 class Function {
 public:
   Name name;
@@ -569,10 +589,20 @@ public:
     bool operator==(const DebugLocation& other) const { return fileIndex == other.fileIndex && lineNumber == other.lineNumber && columnNumber == other.columnNumber; }
     bool operator!=(const DebugLocation& other) const { return !(*this == other); }
   };
-  std::unordered_map<Expression*, DebugLocation> debugLocations;
+  SortedMap<Expression*, DebugLocation> debugLocations;
+
+  // When a module is read lazily, bodies are only decoded when needed. Until
+  // then body is null, and lazyBody has what is needed to decode it.
+  std::unique_ptr<LazyFunctionBody> lazyBody;
 
   Function() : result(none) {}
 
+  bool isLazy() { return lazyBody != nullptr; }
+  // Decodes the body, if it has not been yet.
+  void materialize() {
+    if (lazyBody) doMaterialize();
+  }
+
   size_t getNumParams();
   size_t getNumVars();
   size_t getNumLocals();
@@ -589,6 +619,7 @@ public:
 
 private:
   bool hasLocalName(Index index) const;
+  void doMaterialize();
 };
 
 enum class ExternalKind {
@@ -711,13 +742,18 @@ public:
 
   MixedArena allocator;
 
+  // Arenas that function bodies were moved into by the PassRunner, see
+  // PassOptions::reclaimMemory.
+  std::vector<std::unique_ptr<MixedArena>> bodyArenas;
+
 private:
-  // TODO: add a build option where Names are just indices, and then these methods are not needed
-  std::map<Name, FunctionType*> functionTypesMap;
-  std::map<Name, Import*> importsMap;
-  std::map<Name, Export*> exportsMap; // exports map is by the *exported* name, which is unique
-  std::map<Name, Function*> functionsMap;
-  std::map<Name, Global*> globalsMap;
+  // Names are interned, so these are hashed on the string pointer, and
+  // lookups do not need to compare string contents.
+  NameMap<FunctionType*> functionTypesMap;
+  NameMap<Import*> importsMap;
+  NameMap<Export*> exportsMap; // exports map is by the *exported* name, which is unique
+  NameMap<Function*> functionsMap;
+  NameMap<Global*> globalsMap;
 
 public:
   Module() {};
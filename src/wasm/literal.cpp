@@ -119,19 +119,16 @@ double Literal::setQuietNaN(double f) {
   return bit_cast<double>(0x0008000000000000ull | bit_cast<uint64_t>(f));
 }
 
-void Literal::printFloat(std::ostream &o, float f) {
-  if (std::isnan(f)) {
-    const char* sign = std::signbit(f) ? "-" : "";
-    o << sign << "nan";
-    if (uint32_t payload = NaNPayload(f)) {
-      o << ":0x" << std::hex << payload << std::dec;
-    }
-    return;
-  }
-  printDouble(o, f);
+static void printHex(std::ostream& o, uint64_t x) {
+  o << std::hex << x << std::dec;
 }
 
-void Literal::printDouble(std::ostream& o, double d) {
+static void printHex(TextWriter& o, uint64_t x) {
+  o.writeHex(x);
+}
+
+template<typename Stream>
+static void printDoubleTo(Stream& o, double d) {
   if (d == 0 && std::signbit(d)) {
     o << "-0";
     return;
@@ -139,8 +136,9 @@ void Literal::printDouble(std::ostream& o, double d) {
   if (std::isnan(d)) {
     const char* sign = std::signbit(d) ? "-" : "";
     o << sign << "nan";
-    if (uint64_t payload = NaNPayload(d)) {
-      o << ":0x" << std::hex << payload << std::dec;
+    if (uint64_t payload = Literal::NaNPayload(d)) {
+      o << ":0x";
+      printHex(o, payload);
     }
     return;
   }
@@ -159,21 +157,60 @@ void Literal::printDouble(std::ostream& o, double d) {
   o << text;
 }
 
-std::ostream& operator<<(std::ostream& o, Literal literal) {
+template<typename Stream>
+static void printFloatTo(Stream& o, float f) {
+  if (std::isnan(f)) {
+    const char* sign = std::signbit(f) ? "-" : "";
+    o << sign << "nan";
+    if (uint32_t payload = Literal::NaNPayload(f)) {
+      o << ":0x";
+      printHex(o, payload);
+    }
+    return;
+  }
+  printDoubleTo(o, f);
+}
+
+template<typename Stream>
+static Stream& printLiteral(Stream& o, Literal literal) {
   o << '(';
   prepareMinorColor(o) << printWasmType(literal.type) << ".const ";
   switch (literal.type) {
     case none: o << "?"; break;
-    case WasmType::i32: o << literal.i32; break;
-    case WasmType::i64: o << literal.i64; break;
-    case WasmType::f32: literal.printFloat(o, literal.getf32()); break;
-    case WasmType::f64: literal.printDouble(o, literal.getf64()); break;
+    case WasmType::i32: o << literal.geti32(); break;
+    case WasmType::i64: o << literal.geti64(); break;
+    case WasmType::f32: printFloatTo(o, literal.getf32()); break;
+    case WasmType::f64: printDoubleTo(o, literal.getf64()); break;
     default: WASM_UNREACHABLE();
   }
   restoreNormalColor(o);
   return o << ')';
 }
 
+void Literal::printFloat(std::ostream &o, float f) {
+  printFloatTo(o, f);
+}
+
+void Literal::printDouble(std::ostream& o, double d) {
+  printDoubleTo(o, d);
+}
+
+void Literal::printFloat(TextWriter &o, float f) {
+  printFloatTo(o, f);
+}
+
+void Literal::printDouble(TextWriter& o, double d) {
+  printDoubleTo(o, d);
+}
+
+std::ostream& operator<<(std::ostream& o, Literal literal) {
+  return printLiteral(o, literal);
+}
+
+TextWriter& operator<<(TextWriter& o, Literal literal) {
+  return printLiteral(o, literal);
+}
+
 Literal Literal::countLeadingZeroes() const {
   if (type == WasmType::i32) return Literal((int32_t)CountLeadingZeroes(i32));
   if (type == WasmType::i64) return Literal((int64_t)CountLeadingZeroes(i64));
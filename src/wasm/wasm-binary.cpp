@@ -14,11 +14,15 @@
  * limitations under the License.
  */
 
+#include <cstring>
+#include <exception>
 #include <fstream>
 
 #include "support/bits.h"
+#include "support/threads.h"
 #include "wasm-binary.h"
 #include "ast/branch-utils.h"
+#include "ast_utils.h"
 
 namespace wasm {
 
@@ -34,6 +38,7 @@ void WasmBinaryWriter::prepare() {
 
 void WasmBinaryWriter::write() {
   writeHeader();
+  flush();
   if (sourceMap) {
     writeSourceMapProlog();
   }
@@ -57,6 +62,7 @@ void WasmBinaryWriter::write() {
     writeSourceMapEpilog();
   }
   finishUp();
+  flush();
 }
 
 void WasmBinaryWriter::writeHeader() {
@@ -69,6 +75,7 @@ int32_t WasmBinaryWriter::writeU32LEBPlaceholder() {
   int32_t ret = o.size();
   o << int32_t(0);
   o << int8_t(0);
+  sizePlaceholders.push_back(ret);
   return ret;
 }
 
@@ -90,8 +97,75 @@ int32_t WasmBinaryWriter::startSection(BinaryConsts::Section code) {
 }
 
 void WasmBinaryWriter::finishSection(int32_t start) {
-  int32_t size = o.size() - start - 5; // section size does not include the 5 bytes of the size field itself
-  o.writeAt(start, U32LEB(size));
+  if (shouldCompactSizes()) {
+    compactSection(start);
+  } else {
+    int32_t size = o.size() - start - 5; // section size does not include the 5 bytes of the size field itself
+    o.writeAt(start, U32LEB(size));
+  }
+  sizePlaceholders.clear();
+  flush();
+}
+
+bool WasmBinaryWriter::shouldCompactSizes() {
+  // source maps and buffer pointers refer to absolute offsets in the output,
+  // so when we have those, nothing may move and sizes stay padded
+  return compactSizes && !sourceMap && buffersToWrite.empty();
+}
+
+bool WasmBinaryWriter::isStreaming() {
+  // debug output reports offsets in the buffer, and emitted buffers need
+  // their pointers backpatched, so in those cases keep everything around
+  return outputStream && !debug && buffersToWrite.empty();
+}
+
+void WasmBinaryWriter::flush() {
+  if (!isStreaming()) return;
+  outputStream->write((const char*)o.data(), o.size());
+  flushed += o.size();
+  o.clear();
+}
+
+static size_t getU32LEBSize(uint32_t x) {
+  size_t ret = 1;
+  while (x >>= 7) ret++;
+  return ret;
+}
+
+void WasmBinaryWriter::compactSection(size_t start) {
+  assert(!sizePlaceholders.empty() && sizePlaceholders[0] == start);
+  // the sizes inside the section (function bodies, subsections) have already
+  // been backpatched into their padded placeholders. none of them contains
+  // another placeholder, so their values stay valid as we shrink them.
+  size_t numInner = sizePlaceholders.size() - 1;
+  std::vector<uint32_t> values(numInner);
+  size_t saved = 0;
+  for (size_t i = 0; i < numInner; i++) {
+    size_t at = sizePlaceholders[i + 1];
+    U32LEB value;
+    value.read([&]() { return o[at++]; });
+    values[i] = value.value;
+    saved += 5 - getU32LEBSize(value.value);
+  }
+  size_t size = o.size() - start - 5 - saved;
+  assert(size <= std::numeric_limits<uint32_t>::max());
+  U32LEB(size).writeAt(&o, start);
+  // move everything back in a single forward pass, writing each inner size
+  // minimally as we reach it
+  auto* data = o.data();
+  size_t write = start + getU32LEBSize(size);
+  size_t read = start + 5;
+  for (size_t i = 0; i < numInner; i++) {
+    size_t at = sizePlaceholders[i + 1];
+    memmove(data + write, data + read, at - read);
+    write += at - read;
+    U32LEB(values[i]).writeAt(&o, write);
+    write += getU32LEBSize(values[i]);
+    read = at + 5;
+  }
+  memmove(data + write, data + read, o.size() - read);
+  write += o.size() - read;
+  o.resize(write);
 }
 
 int32_t WasmBinaryWriter::startSubsection(BinaryConsts::UserSections::Subsection code) {
@@ -244,36 +318,134 @@ void WasmBinaryWriter::writeFunctions() {
   auto start = startSection(BinaryConsts::Section::Code);
   size_t total = wasm->functions.size();
   o << U32LEB(total);
+  for (auto& func : wasm->functions) {
+    if (func->isLazy()) {
+      auto* decoder = func->lazyBody->decoder.get();
+      if (!copyableLazyBodies.count(decoder)) {
+        copyableLazyBodies[decoder] = canCopyLazyBodies(static_cast<WasmBinaryLazyDecoder*>(decoder));
+      }
+    }
+  }
+  // function bodies are independent of each other, so when we can, encode
+  // them in parallel. debug output and source maps need to see the bodies
+  // at their final offsets, though.
+  if (!debug && !sourceMap && total > 1 && ThreadPool::get()->size() > 1) {
+    writeFunctionsInParallel();
+  } else {
+    for (size_t i = 0; i < total; i++) {
+      if (debug) std::cerr << "write one at" << o.size() << std::endl;
+      size_t sizePos = writeU32LEBPlaceholder();
+      size_t start = o.size();
+      writeFunctionBody(wasm->functions[i].get());
+      size_t size = o.size() - start;
+      assert(size <= std::numeric_limits<uint32_t>::max());
+      if (debug) std::cerr << "body size: " << size << ", writing at " << sizePos << ", next starts at " << o.size() << std::endl;
+      o.writeAt(sizePos, U32LEB(size));
+    }
+  }
+  finishSection(start);
+}
+
+void WasmBinaryWriter::writeFunctionsInParallel() {
+  size_t total = wasm->functions.size();
+  // each worker has its own writer, writing into its own buffer, and we
+  // note where in which buffer each body ended up
+  size_t num = ThreadPool::get()->size();
+  std::vector<std::unique_ptr<BufferWithRandomAccess>> buffers;
+  std::vector<std::unique_ptr<WasmBinaryWriter>> writers;
+  for (size_t i = 0; i < num; i++) {
+    buffers.emplace_back(new BufferWithRandomAccess(false));
+    writers.emplace_back(new WasmBinaryWriter(*this, *buffers.back()));
+  }
+  struct Location {
+    size_t worker, start, end;
+  };
+  std::vector<Location> locations(total);
+  std::vector<size_t> costs(total);
   for (size_t i = 0; i < total; i++) {
-    if (debug) std::cerr << "write one at" << o.size() << std::endl;
-    size_t sizePos = writeU32LEBPlaceholder();
-    size_t start = o.size();
-    Function* function = wasm->functions[i].get();
-    currFunction = function;
-    mappedLocals.clear();
-    numLocalsByType.clear();
-    if (debug) std::cerr << "writing" << function->name << std::endl;
-    mapLocals(function);
-    o << U32LEB(
-        (numLocalsByType[i32] ? 1 : 0) +
-        (numLocalsByType[i64] ? 1 : 0) +
-        (numLocalsByType[f32] ? 1 : 0) +
-        (numLocalsByType[f64] ? 1 : 0)
-                );
-    if (numLocalsByType[i32]) o << U32LEB(numLocalsByType[i32]) << binaryWasmType(i32);
-    if (numLocalsByType[i64]) o << U32LEB(numLocalsByType[i64]) << binaryWasmType(i64);
-    if (numLocalsByType[f32]) o << U32LEB(numLocalsByType[f32]) << binaryWasmType(f32);
-    if (numLocalsByType[f64]) o << U32LEB(numLocalsByType[f64]) << binaryWasmType(f64);
-
-    writeExpression(function->body);
-    o << int8_t(BinaryConsts::End);
-    size_t size = o.size() - start;
+    auto* func = wasm->functions[i].get();
+    costs[i] = func->isLazy() ? func->lazyBody->size : Measurer::measure(func->body);
+  }
+  WorkStealingScheduler scheduler(num, costs);
+  std::vector<std::function<ThreadWorkState ()>> doWorkers;
+  for (size_t i = 0; i < num; i++) {
+    doWorkers.push_back([&, i]() {
+      size_t index;
+      if (!scheduler.getTask(i, index)) {
+        return ThreadWorkState::Finished;
+      }
+      auto& buffer = *buffers[i];
+      size_t start = buffer.size();
+      writers[i]->writeFunctionBody(wasm->functions[index].get());
+      locations[index] = { i, start, buffer.size() };
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+  // concatenate the bodies in order
+  for (auto& location : locations) {
+    size_t size = location.end - location.start;
     assert(size <= std::numeric_limits<uint32_t>::max());
-    if (debug) std::cerr << "body size: " << size << ", writing at " << sizePos << ", next starts at " << o.size() << std::endl;
+    size_t sizePos = writeU32LEBPlaceholder();
+    auto& buffer = *buffers[location.worker];
+    o.insert(o.end(), buffer.begin() + location.start, buffer.begin() + location.end);
     o.writeAt(sizePos, U32LEB(size));
   }
+}
+
+bool WasmBinaryWriter::canCopyLazyBodies(WasmBinaryLazyDecoder* decoder) {
+  // undecoded bodies can be copied as they were read if every index they may
+  // use still refers to the same thing
+  auto& functionNames = decoder->functionNames;
+  for (Index i = 0; i < functionNames.size(); i++) {
+    auto name = functionNames[i];
+    auto* import = wasm->getImportOrNull(name);
+    if (!wasm->getFunctionOrNull(name) && !(import && import->kind == ExternalKind::Function)) return false;
+    if (getFunctionIndex(name) != i) return false;
+  }
+  auto& globalNames = decoder->globalNames;
+  for (Index i = 0; i < globalNames.size(); i++) {
+    auto name = globalNames[i];
+    auto* import = wasm->getImportOrNull(name);
+    if (!wasm->getGlobalOrNull(name) && !(import && import->kind == ExternalKind::Global)) return false;
+    if (getGlobalIndex(name) != i) return false;
+  }
+  auto& typeNames = decoder->typeNames;
+  if (typeNames.size() > wasm->functionTypes.size()) return false;
+  for (Index i = 0; i < typeNames.size(); i++) {
+    if (wasm->functionTypes[i]->name != typeNames[i]) return false;
+  }
+  return true;
+}
+
+void WasmBinaryWriter::writeFunctionBody(Function* function) {
+  if (function->isLazy()) {
+    auto& lazy = *function->lazyBody;
+    if (copyableLazyBodies.at(lazy.decoder.get())) {
+      o.insert(o.end(), (const uint8_t*)lazy.data, (const uint8_t*)lazy.data + lazy.size);
+      return;
+    }
+    function->materialize();
+  }
+  currFunction = function;
+  mappedLocals.clear();
+  numLocalsByType.clear();
+  if (debug) std::cerr << "writing" << function->name << std::endl;
+  mapLocals(function);
+  o << U32LEB(
+      (numLocalsByType[i32] ? 1 : 0) +
+      (numLocalsByType[i64] ? 1 : 0) +
+      (numLocalsByType[f32] ? 1 : 0) +
+      (numLocalsByType[f64] ? 1 : 0)
+              );
+  if (numLocalsByType[i32]) o << U32LEB(numLocalsByType[i32]) << binaryWasmType(i32);
+  if (numLocalsByType[i64]) o << U32LEB(numLocalsByType[i64]) << binaryWasmType(i64);
+  if (numLocalsByType[f32]) o << U32LEB(numLocalsByType[f32]) << binaryWasmType(f32);
+  if (numLocalsByType[f64]) o << U32LEB(numLocalsByType[f64]) << binaryWasmType(f64);
+
+  writeExpression(function->body);
+  o << int8_t(BinaryConsts::End);
   currFunction = nullptr;
-  finishSection(start);
 }
 
 void WasmBinaryWriter::writeGlobals() {
@@ -318,6 +490,10 @@ void WasmBinaryWriter::writeDataSegments() {
   for (auto& segment : wasm->memory.segments) {
     if (segment.data.size() > 0) num++;
   }
+  if (isStreaming()) {
+    writeDataSegmentsToStream(num);
+    return;
+  }
   auto start = startSection(BinaryConsts::Section::Data);
   o << U32LEB(num);
   for (auto& segment : wasm->memory.segments) {
@@ -330,6 +506,49 @@ void WasmBinaryWriter::writeDataSegments() {
   finishSection(start);
 }
 
+void WasmBinaryWriter::writeDataSegmentsToStream(uint32_t num) {
+  // the contents of the segments can be large, so do not copy them into the
+  // buffer: buffer everything around them, and once the section size is
+  // known, write it all out with the contents interleaved.
+  o << U32LEB(BinaryConsts::Section::Data);
+  size_t start = o.size();
+  o << U32LEB(num);
+  std::vector<std::pair<size_t, const Memory::Segment*>> contents; // buffer position => segment whose data goes there
+  size_t contentsSize = 0;
+  for (auto& segment : wasm->memory.segments) {
+    if (segment.data.size() == 0) continue;
+    o << U32LEB(0); // Linear memory 0 in the MVP
+    writeExpression(segment.offset);
+    o << int8_t(BinaryConsts::End);
+    o << U32LEB(segment.data.size());
+    contents.emplace_back(o.size(), &segment);
+    contentsSize += segment.data.size();
+  }
+  size_t size = o.size() - start + contentsSize;
+  assert(size <= std::numeric_limits<uint32_t>::max());
+  // insert the section size, the same way finishSection() would leave it
+  BufferWithRandomAccess sizeField(false);
+  U32LEB sizeLEB(size);
+  sizeLEB.write(&sizeField);
+  if (!shouldCompactSizes()) {
+    sizeField.resize(5);
+    sizeLEB.writeAt(&sizeField, 0, 5);
+  }
+  o.insert(o.begin() + start, sizeField.begin(), sizeField.end());
+  size_t written = 0;
+  for (auto& pair : contents) {
+    size_t position = pair.first + sizeField.size();
+    outputStream->write((const char*)o.data() + written, position - written);
+    written = position;
+    auto& data = pair.second->data;
+    outputStream->write(&data[0], data.size());
+  }
+  outputStream->write((const char*)o.data() + written, o.size() - written);
+  flushed += o.size() + contentsSize;
+  o.clear();
+  sizePlaceholders.clear();
+}
+
 uint32_t WasmBinaryWriter::getFunctionIndex(Name name) {
   if (!mappedFunctions.size()) {
     // Create name => index mapping.
@@ -531,7 +750,7 @@ void WasmBinaryWriter::finishUp() {
   // finish buffers
   for (const auto& buffer : buffersToWrite) {
     if (debug) std::cerr << "writing buffer" << (int)buffer.data[0] << "," << (int)buffer.data[1] << " at " << o.size() << " and pointer is at " << buffer.pointerLocation << std::endl;
-    o.writeAt(buffer.pointerLocation, (uint32_t)o.size());
+    o.writeAt(buffer.pointerLocation, (uint32_t)(flushed + o.size()));
     for (size_t i = 0; i < buffer.size; i++) {
       o << (uint8_t)buffer.data[i];
     }
@@ -1175,7 +1394,7 @@ void WasmBinaryBuilder::read() {
   while (more()) {
     uint32_t sectionCode = getU32LEB();
     uint32_t payloadLen = getU32LEB();
-    if (pos + payloadLen > input.size()) throw ParseException("Section extends beyond end of input");
+    if (pos + payloadLen > inputSize) throw ParseException("Section extends beyond end of input");
 
     auto oldPos = pos;
 
@@ -1235,10 +1454,9 @@ void WasmBinaryBuilder::readUserSection(size_t payloadLen) {
     auto& section = wasm.userSections.back();
     section.name = sectionName.str;
     auto sectionSize = payloadLen - (pos - oldPos);
-    section.data.resize(sectionSize);
-    for (size_t i = 0; i < sectionSize; i++) {
-      section.data[i] = getInt8();
-    }
+    if (sectionSize > inputSize - pos) throw ParseException("unexpected end of input");
+    section.data.assign(input + pos, input + pos + sectionSize);
+    pos += sectionSize;
   }
 }
 
@@ -1257,6 +1475,12 @@ uint16_t WasmBinaryBuilder::getInt16() {
 }
 
 uint32_t WasmBinaryBuilder::getInt32() {
+  if (!debug && inputSize - pos >= 4) {
+    // read the little-endian word in one go
+    auto* p = (const uint8_t*)&input[pos];
+    pos += 4;
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+  }
   if (debug) std::cerr << "<==" << std::endl;
   auto ret = uint32_t(getInt16());
   ret |= uint32_t(getInt16()) << 16;
@@ -1265,6 +1489,10 @@ uint32_t WasmBinaryBuilder::getInt32() {
 }
 
 uint64_t WasmBinaryBuilder::getInt64() {
+  if (!debug && inputSize - pos >= 8) {
+    auto low = getInt32();
+    return uint64_t(low) | (uint64_t(getInt32()) << 32);
+  }
   if (debug) std::cerr << "<==" << std::endl;
   auto ret = uint64_t(getInt32());
   ret |= uint64_t(getInt32()) << 32;
@@ -1289,6 +1517,14 @@ Literal WasmBinaryBuilder::getFloat64Literal() {
 }
 
 uint32_t WasmBinaryBuilder::getU32LEB() {
+  if (!debug && inputSize - pos >= 5) {
+    // even the longest valid LEB is in bounds, so skip the checks in getInt8
+    U32LEB ret;
+    ret.read([&]() {
+      return (uint8_t)input[pos++];
+    });
+    return ret.value;
+  }
   if (debug) std::cerr << "<==" << std::endl;
   U32LEB ret;
   ret.read([&]() {
@@ -1299,6 +1535,14 @@ uint32_t WasmBinaryBuilder::getU32LEB() {
 }
 
 uint64_t WasmBinaryBuilder::getU64LEB() {
+  if (!debug && inputSize - pos >= 10) {
+    // fast path, as in getU32LEB
+    U64LEB ret;
+    ret.read([&]() {
+      return (uint8_t)input[pos++];
+    });
+    return ret.value;
+  }
   if (debug) std::cerr << "<==" << std::endl;
   U64LEB ret;
   ret.read([&]() {
@@ -1309,6 +1553,14 @@ uint64_t WasmBinaryBuilder::getU64LEB() {
 }
 
 int32_t WasmBinaryBuilder::getS32LEB() {
+  if (!debug && inputSize - pos >= 5) {
+    // fast path, as in getU32LEB
+    S32LEB ret;
+    ret.read([&]() {
+      return (int8_t)input[pos++];
+    });
+    return ret.value;
+  }
   if (debug) std::cerr << "<==" << std::endl;
   S32LEB ret;
   ret.read([&]() {
@@ -1319,6 +1571,14 @@ int32_t WasmBinaryBuilder::getS32LEB() {
 }
 
 int64_t WasmBinaryBuilder::getS64LEB() {
+  if (!debug && inputSize - pos >= 10) {
+    // fast path, as in getU32LEB
+    S64LEB ret;
+    ret.read([&]() {
+      return (int8_t)input[pos++];
+    });
+    return ret.value;
+  }
   if (debug) std::cerr << "<==" << std::endl;
   S64LEB ret;
   ret.read([&]() {
@@ -1545,71 +1805,234 @@ void WasmBinaryBuilder::readFunctions() {
   if (total != functionTypes.size()) {
     throw ParseException("invalid function section size, must equal types");
   }
+  // source maps refer to the bodies in order, so they must be read now
+  if (lazy && !sourceMap) {
+    readFunctionsLazily(total);
+    return;
+  }
+  // function bodies are independent of each other, so when we can, decode
+  // them in parallel. debug output and source maps are sequential, though.
+  if (!debug && !sourceMap && total > 1 && ThreadPool::get()->size() > 1) {
+    readFunctionsInParallel(total);
+    return;
+  }
   for (size_t i = 0; i < total; i++) {
     if (debug) std::cerr << "read one at " << pos << std::endl;
     size_t size = getU32LEB();
     if (size == 0) {
       throw ParseException("empty function size");
     }
-    endOfFunction = pos + size;
-    auto type = functionTypes[i];
-    if (debug) std::cerr << "reading " << i << std::endl;
-    size_t nextVar = 0;
-    auto addVar = [&]() {
-      Name name = cashew::IString(("var$" + std::to_string(nextVar++)).c_str(), false);
-      return name;
-    };
-    std::vector<NameType> params, vars;
-    for (size_t j = 0; j < type->params.size(); j++) {
-      params.emplace_back(addVar(), type->params[j]);
-    }
-    size_t numLocalTypes = getU32LEB();
-    for (size_t t = 0; t < numLocalTypes; t++) {
-      auto num = getU32LEB();
-      auto type = getWasmType();
-      while (num > 0) {
-        vars.emplace_back(addVar(), type);
-        num--;
-      }
+    functions.push_back(readFunction(i, size));
+  }
+  if (debug) std::cerr << " end function bodies" << std::endl;
+}
+
+void WasmBinaryBuilder::readFunctionsInParallel(size_t total) {
+  // bodies are size-prefixed, so we can find them all without decoding them
+  std::vector<size_t> starts, sizes;
+  for (size_t i = 0; i < total; i++) {
+    size_t size = getU32LEB();
+    if (size == 0) {
+      throw ParseException("empty function size");
     }
-    auto func = Builder(wasm).makeFunction(
-        Name::fromInt(i),
-        std::move(params),
-        type->result,
-        std::move(vars)
-                                           );
-    func->type = type->name;
-    currFunction = func;
-    {
-      // process the function body
-      if (debug) std::cerr << "processing function: " << i << std::endl;
-      nextLabel = 0;
-      useDebugLocation = false;
-      breaksToReturn = false;
-      // process body
-      assert(breakStack.empty());
-      breakStack.emplace_back(RETURN_BREAK, func->result != none); // the break target for the function scope
-      assert(expressionStack.empty());
-      assert(depth == 0);
-      func->body = getMaybeBlock(func->result);
-      assert(depth == 0);
-      assert(breakStack.size() == 1);
-      breakStack.pop_back();
-      if (!expressionStack.empty()) {
-        throw ParseException("stack not empty on function exit");
+    if (size > inputSize - pos) {
+      throw ParseException("unexpected end of input");
+    }
+    starts.push_back(pos);
+    sizes.push_back(size);
+    pos += size;
+  }
+  size_t end = pos;
+  getGlobalName(Index(-1)); // workers share the global mapping, so create it now
+  // decode on the pool. each worker has its own builder, with its own
+  // position and parsing state, and allocates in its own side arena
+  size_t num = ThreadPool::get()->size();
+  std::vector<std::unique_ptr<WasmBinaryBuilder>> workers;
+  for (size_t i = 0; i < num; i++) {
+    workers.emplace_back(new WasmBinaryBuilder(*this));
+  }
+  functions.resize(total);
+  // a parse error is reported from the first function that has one, as it
+  // would be when decoding sequentially
+  std::vector<std::exception_ptr> errors(total);
+  WorkStealingScheduler scheduler(num, sizes);
+  std::vector<std::function<ThreadWorkState ()>> doWorkers;
+  for (size_t i = 0; i < num; i++) {
+    doWorkers.push_back([&, i]() {
+      size_t index;
+      if (!scheduler.getTask(i, index)) {
+        return ThreadWorkState::Finished;
       }
-      if (pos != endOfFunction) {
-        throw ParseException("binary offset at function exit not at expected location");
+      auto& worker = *workers[i];
+      try {
+        worker.pos = starts[index];
+        functions[index] = worker.readFunction(index, sizes[index]);
+      } catch (...) {
+        errors[index] = std::current_exception();
+        // the worker may have been left mid-function
+        worker.currFunction = nullptr;
+        worker.breakStack.clear();
+        worker.expressionStack.clear();
+        worker.depth = 0;
       }
-      if (breaksToReturn) {
-        // we broke to return, so we need an outer block to break to
-        func->body = Builder(wasm).blockifyWithName(func->body, RETURN_BREAK);
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+  for (auto& error : errors) {
+    if (error) {
+      for (auto* func : functions) {
+        delete func;
       }
+      functions.clear();
+      std::rethrow_exception(error);
+    }
+  }
+  for (auto& worker : workers) {
+    for (auto& pair : worker->functionCalls) {
+      auto& calls = functionCalls[pair.first];
+      calls.insert(calls.end(), pair.second.begin(), pair.second.end());
+    }
+  }
+  pos = end;
+}
+
+void WasmBinaryBuilder::readFunctionsLazily(size_t total) {
+  if (!lazyDecoder) {
+    getGlobalName(Index(-1)); // the decoder shares the global mapping, so create it now
+    lazyDecoder = std::make_shared<WasmBinaryLazyDecoder>(*this, lazyInput);
+  }
+  for (size_t i = 0; i < total; i++) {
+    size_t size = getU32LEB();
+    if (size == 0) {
+      throw ParseException("empty function size");
     }
-    currFunction = nullptr;
+    if (size > inputSize - pos) {
+      throw ParseException("unexpected end of input");
+    }
+    // read the signature and locals, which are cheap and used all over,
+    // and leave the body for later
+    size_t start = pos;
+    auto* func = readFunctionHeader(functions.size(), size);
+    func->lazyBody = std::unique_ptr<LazyFunctionBody>(new LazyFunctionBody{ lazyDecoder, input + start, size, Index(functions.size()) });
     functions.push_back(func);
+    pos = start + size;
   }
-  if (debug) std::cerr << " end function bodies" << std::endl;
+}
+
+Function* WasmBinaryBuilder::readFunction(Index i, size_t size) {
+  auto* func = readFunctionHeader(i, size);
+  readFunctionBody(func);
+  return func;
+}
+
+Function* WasmBinaryBuilder::readFunctionHeader(Index i, size_t size) {
+  if (i >= functionTypes.size()) {
+    throw ParseException("too many function bodies");
+  }
+  endOfFunction = pos + size;
+  auto type = functionTypes[i];
+  if (debug) std::cerr << "reading " << i << std::endl;
+  size_t nextVar = 0;
+  auto addVar = [&]() {
+    Name name = cashew::IString(("var$" + std::to_string(nextVar++)).c_str(), false);
+    return name;
+  };
+  std::vector<NameType> params, vars;
+  for (size_t j = 0; j < type->params.size(); j++) {
+    params.emplace_back(addVar(), type->params[j]);
+  }
+  size_t numLocalTypes = getU32LEB();
+  for (size_t t = 0; t < numLocalTypes; t++) {
+    auto num = getU32LEB();
+    auto type = getWasmType();
+    while (num > 0) {
+      vars.emplace_back(addVar(), type);
+      num--;
+    }
+  }
+  auto func = Builder(wasm).makeFunction(
+      Name::fromInt(i),
+      std::move(params),
+      type->result,
+      std::move(vars)
+                                         );
+  func->type = type->name;
+  return func;
+}
+
+void WasmBinaryBuilder::readFunctionBody(Function* func) {
+  currFunction = func;
+  {
+    // process the function body
+    if (debug) std::cerr << "processing function: " << func->name << std::endl;
+    nextLabel = 0;
+    useDebugLocation = false;
+    breaksToReturn = false;
+    // process body
+    assert(breakStack.empty());
+    breakStack.emplace_back(RETURN_BREAK, func->result != none); // the break target for the function scope
+    assert(expressionStack.empty());
+    assert(depth == 0);
+    func->body = getMaybeBlock(func->result);
+    assert(depth == 0);
+    assert(breakStack.size() == 1);
+    breakStack.pop_back();
+    if (!expressionStack.empty()) {
+      throw ParseException("stack not empty on function exit");
+    }
+    if (pos != endOfFunction) {
+      throw ParseException("binary offset at function exit not at expected location");
+    }
+    if (breaksToReturn) {
+      // we broke to return, so we need an outer block to break to
+      func->body = Builder(wasm).blockifyWithName(func->body, RETURN_BREAK);
+    }
+  }
+  currFunction = nullptr;
+}
+
+void WasmBinaryBuilder::decodeLazyFunction(Function* func, const std::vector<Name>& functionNames) {
+  auto& lazy = *func->lazyBody;
+  pos = lazy.data - input;
+  endOfFunction = pos + lazy.size;
+  // skip the local declarations, which were read with the signature
+  size_t numLocalTypes = getU32LEB();
+  for (size_t t = 0; t < numLocalTypes; t++) {
+    getU32LEB();
+    getWasmType();
+  }
+  readFunctionBody(func);
+  for (auto& pair : functionCalls) {
+    for (auto* call : pair.second) {
+      call->target = functionNames[functionImportIndexes.size() + pair.first];
+    }
+  }
+  functionCalls.clear();
+}
+
+void WasmBinaryLazyDecoder::decode(Function* func) {
+  // each thread decodes with a builder of its own
+  std::unique_ptr<WasmBinaryBuilder> builder;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!idle.empty()) {
+      builder = std::move(idle.back());
+      idle.pop_back();
+    }
+  }
+  if (!builder) {
+    builder = std::unique_ptr<WasmBinaryBuilder>(new WasmBinaryBuilder(*prototype));
+  }
+  try {
+    builder->decodeLazyFunction(func, functionNames);
+  } catch (ParseException& p) {
+    // this happens long after reading, where nothing expects parse errors
+    p.dump(std::cerr);
+    Fatal() << "error in decoding a lazily-read function body";
+  }
+  std::lock_guard<std::mutex> lock(mutex);
+  idle.push_back(std::move(builder));
 }
 
 void WasmBinaryBuilder::readExports() {
@@ -1912,6 +2335,20 @@ void WasmBinaryBuilder::processFunctions() {
       wasm.table.segments[i].data.push_back(getFunctionIndexName(j));
     }
   }
+
+  if (lazyDecoder) {
+    // note the index spaces that the lazy bodies refer to
+    lazyDecoder->functionNames = functionImportIndexes;
+    for (auto& func : wasm.functions) {
+      lazyDecoder->functionNames.push_back(func->name);
+    }
+    for (auto& pair : mappedGlobals) {
+      lazyDecoder->globalNames.push_back(pair.second);
+    }
+    for (auto& type : wasm.functionTypes) {
+      lazyDecoder->typeNames.push_back(type->name);
+    }
+  }
 }
 
 void WasmBinaryBuilder::readDataSegments() {
@@ -1926,12 +2363,10 @@ void WasmBinaryBuilder::readDataSegments() {
     Memory::Segment curr;
     auto offset = readExpression();
     auto size = getU32LEB();
-    std::vector<char> buffer;
-    buffer.resize(size);
-    for (size_t j = 0; j < size; j++) {
-      buffer[j] = char(getInt8());
-    }
-    wasm.memory.segments.emplace_back(offset, (const char*)&buffer[0], size);
+    if (size > inputSize - pos) throw ParseException("unexpected end of input");
+    // copy the data straight from the input, once
+    wasm.memory.segments.emplace_back(offset, input + pos, size);
+    pos += size;
   }
 }
 
@@ -2067,7 +2502,7 @@ BinaryConsts::ASTNodes WasmBinaryBuilder::readExpression(Expression*& curr) {
     }
   }
   if (useDebugLocation && curr) {
-    currFunction->debugLocations[curr] = debugLocation;
+    currFunction->debugLocations.set(curr, debugLocation);
   }
   if (debug) std::cerr << "zz recurse from " << depth-- << " at " << pos << std::endl;
   return BinaryConsts::ASTNodes(code);
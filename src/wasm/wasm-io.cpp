@@ -41,8 +41,9 @@ void ModuleReader::readText(std::string filename, Module& wasm) {
 
 void ModuleReader::readBinary(std::string filename, Module& wasm) {
   if (debug) std::cerr << "reading binary from " << filename << "\n";
-  auto input(read_file<std::vector<char>>(filename, Flags::Binary, debug ? Flags::Debug : Flags::Release));
-  WasmBinaryBuilder parser(wasm, input, debug);
+  auto input = std::make_shared<MappedFile>(filename, debug ? Flags::Debug : Flags::Release);
+  WasmBinaryBuilder parser(wasm, input->data(), input->size(), debug);
+  if (lazy) parser.setLazy(input);
   parser.read();
 }
 
@@ -70,6 +71,7 @@ void ModuleWriter::writeText(Module& wasm, std::string filename) {
 
 void ModuleWriter::writeBinary(Module& wasm, std::string filename) {
   if (debug) std::cerr << "writing binary to " << filename << "\n";
+  Output output(filename, Flags::Binary, debug ? Flags::Debug : Flags::Release);
   BufferWithRandomAccess buffer(debug);
   WasmBinaryWriter writer(&wasm, buffer, debug);
   // if debug info is used, then we want to emit the names section
@@ -81,8 +83,9 @@ void ModuleWriter::writeBinary(Module& wasm, std::string filename) {
     writer.setSourceMap(sourceMapStream.get(), sourceMapUrl);
   }
   if (symbolMap.size() > 0) writer.setSymbolMap(symbolMap);
+  writer.setOutputStream(&output.getStream());
   writer.write();
-  Output output(filename, Flags::Binary, debug ? Flags::Debug : Flags::Release);
+  // anything not yet streamed out, which is everything when debugging
   buffer.writeTo(output);
   if (sourceMapStream) {
     sourceMapStream->close();
@@ -17,13 +17,17 @@
 #include "wasm-s-parser.h"
 
 #include <cmath>
+#include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <exception>
 #include <limits>
 
 #include "asm_v_wasm.h"
 #include "asmjs/shared-constants.h"
 #include "ast/branch-utils.h"
 #include "shared-constants.h"
+#include "support/threads.h"
 #include "wasm-binary.h"
 #include "wasm-builder.h"
 
@@ -43,6 +47,11 @@ int unhex(char c) {
 
 namespace wasm {
 
+// isspace() without the locale lookup, for the tokenizer's inner loops
+static inline bool isSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
 static Address getCheckedAddress(const Element* s, const char* errorText) {
   uint64_t num = atoll(s->c_str());
   if (num > std::numeric_limits<Address::address_t>::max()) {
@@ -51,30 +60,49 @@ static Address getCheckedAddress(const Element* s, const char* errorText) {
   return num;
 }
 
-Element::List& Element::list() {
+Element* Element::operator[](unsigned i) {
   if (!isList()) throw ParseException("expected list", line, col);
-  return list_;
+  if (i >= size_) throw ParseException("expected more elements in list", line, col);
+  return items_[i];
 }
 
-Element* Element::operator[](unsigned i) {
+size_t Element::size() {
   if (!isList()) throw ParseException("expected list", line, col);
-  if (i >= list().size()) throw ParseException("expected more elements in list", line, col);
-  return list()[i];
+  return size_;
+}
+
+void Element::setList(Element** items, size_t size) {
+  assert(isList());
+  items_ = items;
+  size_ = size;
 }
 
 IString Element::str() const {
   if (!isStr()) throw ParseException("expected string", line, col);
-  return str_;
+  if (!interned_) return IString(chars_, false);
+  IString ret;
+  ret.str = chars_;
+  return ret;
 }
 
 const char* Element::c_str() const {
   if (!isStr()) throw ParseException("expected string", line, col);
-  return str_.str;
+  return chars_;
 }
 
 Element* Element::setString(IString str__, bool dollared__, bool quoted__) {
   isList_ = false;
-  str_ = str__;
+  chars_ = str__.str;
+  interned_ = true;
+  dollared_ = dollared__;
+  quoted_ = quoted__;
+  return this;
+}
+
+Element* Element::setRawString(const char* chars__, bool dollared__, bool quoted__) {
+  isList_ = false;
+  chars_ = chars__;
+  interned_ = false;
   dollared_ = dollared__;
   quoted_ = quoted__;
   return this;
@@ -90,10 +118,10 @@ Element* Element::setMetadata(size_t line_, size_t col_, SourceLocation* loc_) {
 std::ostream& operator<<(std::ostream& o, Element& e) {
   if (e.isList_) {
     o << '(';
-    for (auto item : e.list_) o << ' ' << *item;
+    for (size_t i = 0; i < e.size_; i++) o << ' ' << *e.items_[i];
     o << " )";
   } else {
-    o << e.str_.str;
+    o << e.chars_;
   }
   return o;
 }
@@ -113,15 +141,28 @@ SExpressionParser::SExpressionParser(char* input) : input(input), loc(nullptr) {
 }
 
 Element* SExpressionParser::parse() {
-  std::vector<Element *> stack;
+  // the items of all the open lists, one after the other. when a list is
+  // closed, its items get their final storage, of the exact size, and are
+  // popped
+  std::vector<Element*> items;
+  std::vector<size_t> starts;
+  std::vector<Element*> stack;
   std::vector<SourceLocation*> stackLocs;
   Element *curr = allocator.alloc<Element>();
+  auto finish = [&](Element* list, size_t start) {
+    size_t size = items.size() - start;
+    auto* storage = static_cast<Element**>(allocator.allocSpace(sizeof(Element*) * size));
+    std::copy(items.begin() + start, items.end(), storage);
+    list->setList(storage, size);
+    items.resize(start);
+  };
   while (1) {
     skipWhitespace();
     if (input[0] == 0) break;
     if (input[0] == '(') {
       input++;
       stack.push_back(curr);
+      starts.push_back(items.size());
       curr = allocator.alloc<Element>()->setMetadata(line, input - lineStart - 1, loc);
       stackLocs.push_back(loc);
       assert(stack.size() == stackLocs.size());
@@ -131,17 +172,20 @@ Element* SExpressionParser::parse() {
       if (stack.empty()) {
         throw ParseException("s-expr stack empty");
       }
+      finish(last, starts.back());
+      starts.pop_back();
       curr = stack.back();
       assert(stack.size() == stackLocs.size());
       stack.pop_back();
       loc = stackLocs.back();
       stackLocs.pop_back();
-      curr->list().push_back(last);
+      items.push_back(last);
     } else {
-      curr->list().push_back(parseString());
+      items.push_back(parseString());
     }
   }
   if (stack.size() != 0) throw ParseException("stack is not empty", curr->line, curr->col);
+  finish(curr, 0);
   return curr;
 }
 
@@ -170,7 +214,7 @@ void SExpressionParser::parseDebugLocation() {
 
 void SExpressionParser::skipWhitespace() {
   while (1) {
-    while (isspace(input[0])) {
+    while (isSpace(input[0])) {
       if (input[0] == '\n') {
         line++;
         lineStart = input + 1;
@@ -221,36 +265,49 @@ Element* SExpressionParser::parseString() {
     input++;
     dollared = true;
   }
-  char *start = input;
   if (input[0] == '"') {
-    // parse escaping \", but leave code escaped - we'll handle escaping in memory segments specifically
-    input++;
-    std::string str;
-    while (1) {
-      if (input[0] == 0) throw ParseException("unterminated string", line, start - lineStart);
-      if (input[0] == '"') break;
-      if (input[0] == '\\') {
-        str += input[0];
-        if (input[1] == 0) throw ParseException("unterminated string escape", line, start - lineStart);
-        str += input[1];
-        input += 2;
-        continue;
-      }
-      str += input[0];
-      input++;
-    }
-    input++;
-    return allocator.alloc<Element>()->setString(IString(str.c_str(), false), dollared, true)->setMetadata(line, start - lineStart, loc);
+    return parseQuotedString(dollared);
   }
-  while (input[0] && !isspace(input[0]) && input[0] != ')' && input[0] != '(' && input[0] != ';') input++;
+  char *start = input;
+  while (input[0] && !isSpace(input[0]) && input[0] != ')' && input[0] != '(' && input[0] != ';') input++;
   if (start == input) throw ParseException("expected string", line, input - lineStart);
+  auto* ret = allocator.alloc<Element>()->setMetadata(line, start - lineStart, loc);
+  if (!dollared && (isdigit(start[0]) || ((start[0] == '-' || start[0] == '+') && isdigit(start[1])))) {
+    // a number. copy it out, as what follows it in the input may matter
+    size_t size = input - start;
+    auto* chars = static_cast<char*>(allocator.allocSpace(size + 1));
+    memcpy(chars, start, size);
+    chars[size] = 0;
+    return ret->setRawString(chars, dollared, false);
+  }
   char temp = input[0];
   input[0] = 0;
-  auto ret = allocator.alloc<Element>()->setString(IString(start, false), dollared, false)->setMetadata(line, start - lineStart, loc);
+  ret->setString(IString(start, false), dollared, false);
   input[0] = temp;
   return ret;
 }
 
+Element* SExpressionParser::parseQuotedString(bool dollared) {
+  // leave escapes as they are, we'll handle escaping in memory segments
+  // specifically. the closing quote is not needed, so the string is
+  // terminated in place
+  char *start = input;
+  input++;
+  while (1) {
+    if (input[0] == 0) throw ParseException("unterminated string", line, start - lineStart);
+    if (input[0] == '"') break;
+    if (input[0] == '\\') {
+      if (input[1] == 0) throw ParseException("unterminated string escape", line, start - lineStart);
+      input += 2;
+      continue;
+    }
+    input++;
+  }
+  input[0] = 0;
+  input++;
+  return allocator.alloc<Element>()->setRawString(start + 1, dollared, true)->setMetadata(line, start - lineStart, loc);
+}
+
 SExpressionWasmBuilder::SExpressionWasmBuilder(Module& wasm, Element& module, Name* moduleName) : wasm(wasm), allocator(wasm.allocator), globalCounter(0) {
   if (module.size() == 0) throw ParseException("empty toplevel, expected module");
   if (module[0]->str() != MODULE) throw ParseException("toplevel does not start with module");
@@ -289,6 +346,103 @@ SExpressionWasmBuilder::SExpressionWasmBuilder(Module& wasm, Element& module, Na
   for (unsigned j = i; j < module.size(); j++) {
     parseModuleElement(*module[j]);
   }
+  parseFunctionBodies();
+}
+
+SExpressionWasmBuilder::SExpressionWasmBuilder(SExpressionWasmBuilder& parent) : wasm(parent.wasm), allocator(parent.allocator), functionNames(parent.functionNames), functionTypeNames(parent.functionTypeNames), globalNames(parent.globalNames), functionCounter(0), globalCounter(0), functionTypes(parent.functionTypes) {}
+
+void SExpressionWasmBuilder::parseFunctionBodies() {
+  size_t total = functionsToParse.size();
+  size_t num = ThreadPool::get()->size();
+  if (total <= 1 || num <= 1 || ThreadPool::isRunning()) {
+    for (auto& curr : functionsToParse) {
+      auto func = parseFunctionBody(*curr.s, curr.i, curr.name, false);
+      addFunction(std::move(func), currDebugInfoFiles, *curr.s);
+    }
+    functionsToParse.clear();
+    return;
+  }
+  // bodies only read the rest of the module, so they can be parsed in
+  // parallel. each worker has its own builder, with its own function parsing
+  // state, and allocates in its own arena. the number of lines a function
+  // spans tells roughly how much work it is
+  std::vector<size_t> costs(total);
+  for (size_t i = 0; i + 1 < total; i++) {
+    costs[i] = std::max(functionsToParse[i + 1].s->line, functionsToParse[i].s->line) - functionsToParse[i].s->line + 1;
+  }
+  costs[total - 1] = *std::max_element(costs.begin(), costs.end() - 1);
+  std::vector<std::unique_ptr<SExpressionWasmBuilder>> workers;
+  for (size_t i = 0; i < num; i++) {
+    workers.emplace_back(new SExpressionWasmBuilder(*this));
+  }
+  std::vector<std::unique_ptr<Function>> functions(total);
+  std::vector<std::vector<IString>> debugInfoFiles(total);
+  // a parse error is reported from the first function that has one, as it
+  // would be when parsing sequentially
+  std::vector<std::exception_ptr> errors(total);
+  WorkStealingScheduler scheduler(num, costs);
+  std::vector<std::function<ThreadWorkState ()>> doWorkers;
+  for (size_t i = 0; i < num; i++) {
+    doWorkers.push_back([&, i]() {
+      size_t index;
+      if (!scheduler.getTask(i, index)) {
+        return ThreadWorkState::Finished;
+      }
+      auto& worker = *workers[i];
+      auto& curr = functionsToParse[index];
+      try {
+        functions[index] = worker.parseFunctionBody(*curr.s, curr.i, curr.name, false);
+        debugInfoFiles[index].swap(worker.currDebugInfoFiles);
+      } catch (...) {
+        errors[index] = std::current_exception();
+      }
+      // the worker may have been left mid-function
+      worker.resetFunctionState();
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+  for (auto& error : errors) {
+    if (error) {
+      functionsToParse.clear();
+      std::rethrow_exception(error);
+    }
+  }
+  for (size_t i = 0; i < total; i++) {
+    addFunction(std::move(functions[i]), debugInfoFiles[i], *functionsToParse[i].s);
+  }
+  functionsToParse.clear();
+}
+
+void SExpressionWasmBuilder::resetFunctionState() {
+  currFunction = nullptr;
+  currLocalTypes.clear();
+  nameMapper.clear();
+  currDebugInfoFiles.clear();
+  currDebugInfoFileIndices.clear();
+}
+
+void SExpressionWasmBuilder::addFunction(std::unique_ptr<Function> func, std::vector<IString>& debugInfoFiles, Element& s) {
+  // number the debug info files the function refers to in the module, in
+  // the order the function first used them
+  if (!debugInfoFiles.empty()) {
+    std::vector<Index> indexes;
+    for (auto file : debugInfoFiles) {
+      auto iter = debugInfoFileIndices.find(file);
+      if (iter == debugInfoFileIndices.end()) {
+        Index index = wasm.debugInfoFileNames.size();
+        wasm.debugInfoFileNames.push_back(file.c_str());
+        iter = debugInfoFileIndices.emplace(file, index).first;
+      }
+      indexes.push_back(iter->second);
+    }
+    func->debugLocations.forEach([&](Expression* curr, Function::DebugLocation& location) {
+      location.fileIndex = indexes[location.fileIndex];
+    });
+    debugInfoFiles.clear();
+  }
+  if (wasm.getFunctionOrNull(func->name)) throw ParseException("duplicate function", s.line, s.col);
+  wasm.addFunction(func.release());
 }
 
 bool SExpressionWasmBuilder::isImport(Element& curr) {
@@ -333,7 +487,7 @@ Name SExpressionWasmBuilder::getFunctionName(Element& s) {
     return s.str();
   } else {
     // index
-    size_t offset = atoi(s.str().c_str());
+    size_t offset = atoi(s.c_str());
     if (offset >= functionNames.size()) throw ParseException("unknown function in getFunctionName");
     return functionNames[offset];
   }
@@ -344,7 +498,7 @@ Name SExpressionWasmBuilder::getFunctionTypeName(Element& s) {
     return s.str();
   } else {
     // index
-    size_t offset = atoi(s.str().c_str());
+    size_t offset = atoi(s.c_str());
     if (offset >= functionTypeNames.size()) throw ParseException("unknown function type in getFunctionTypeName");
     return functionTypeNames[offset];
   }
@@ -355,7 +509,7 @@ Name SExpressionWasmBuilder::getGlobalName(Element& s) {
     return s.str();
   } else {
     // index
-    size_t offset = atoi(s.str().c_str());
+    size_t offset = atoi(s.c_str());
     if (offset >= globalNames.size()) throw ParseException("unknown global in getGlobalName");
     return globalNames[offset];
   }
@@ -478,6 +632,17 @@ void SExpressionWasmBuilder::parseFunction(Element& s, bool preParseImport) {
     if (wasm.getExportOrNull(ex->name)) throw ParseException("duplicate export", s.line, s.col);
     wasm.addExport(ex.release());
   }
+  if (!preParseImport) {
+    functionsToParse.push_back({ &s, i, name });
+    return;
+  }
+  parseFunctionBody(s, i, name, preParseImport);
+}
+
+std::unique_ptr<Function> SExpressionWasmBuilder::parseFunctionBody(Element& s, size_t i, Name name, bool preParseImport) {
+  // labels are made unique in each function on its own, so that the result
+  // does not depend on which functions were parsed before this one
+  nameMapper.otherIndex = 0;
   Expression* body = nullptr;
   localIndex = 0;
   otherIndex = 0;
@@ -591,7 +756,7 @@ void SExpressionWasmBuilder::parseFunction(Element& s, bool preParseImport) {
     if (currFunction) throw ParseException("import module inside function dec");
     currLocalTypes.clear();
     nameMapper.clear();
-    return;
+    return nullptr;
   }
   if (preParseImport) throw ParseException("preParseImport in func");
   if (brokeToAutoBlock) {
@@ -608,10 +773,10 @@ void SExpressionWasmBuilder::parseFunction(Element& s, bool preParseImport) {
   if (currFunction->result != result) throw ParseException("bad func declaration", s.line, s.col);
   currFunction->body = body;
   currFunction->type = type;
-  if (wasm.getFunctionOrNull(currFunction->name)) throw ParseException("duplicate function", s.line, s.col);
-  wasm.addFunction(currFunction.release());
   currLocalTypes.clear();
   nameMapper.clear();
+  currDebugInfoFileIndices.clear();
+  return std::move(currFunction);
 }
 
 WasmType SExpressionWasmBuilder::stringToWasmType(const char* str, bool allowError, bool prefix) {
@@ -629,17 +794,15 @@ WasmType SExpressionWasmBuilder::stringToWasmType(const char* str, bool allowErr
 
 Expression* SExpressionWasmBuilder::parseExpression(Element& s) {
   Expression* result = makeExpression(s);
-  if (s.loc) {
+  if (s.loc && currFunction) {
     IString file = s.loc->filename;
-    auto& debugInfoFileNames = wasm.debugInfoFileNames;
-    auto iter = debugInfoFileIndices.find(file);
-    if (iter == debugInfoFileIndices.end()) {
-      Index index = debugInfoFileNames.size();
-      debugInfoFileNames.push_back(file.c_str());
-      debugInfoFileIndices[file] = index;
+    auto iter = currDebugInfoFileIndices.find(file);
+    if (iter == currDebugInfoFileIndices.end()) {
+      Index index = currDebugInfoFiles.size();
+      currDebugInfoFiles.push_back(file);
+      iter = currDebugInfoFileIndices.emplace(file, index).first;
     }
-    uint32_t fileIndex = debugInfoFileIndices[file];
-    currFunction->debugLocations[result] = {fileIndex, s.loc->line, s.loc->column};
+    currFunction->debugLocations.set(result, {iter->second, s.loc->line, s.loc->column});
   }
   return result;
 }
@@ -1121,7 +1284,7 @@ Expression* SExpressionWasmBuilder::makeThenOrElse(Element& s) {
 }
 
 Expression* SExpressionWasmBuilder::makeConst(Element& s, WasmType type) {
-  auto ret = parseConst(s[1]->str(), type, allocator);
+  auto ret = parseConst(s[1]->c_str(), type, allocator);
   if (!ret) throw ParseException("bad const");
   return ret;
 }
@@ -1336,7 +1499,9 @@ Expression* SExpressionWasmBuilder::makeCall(Element& s) {
   }
   auto ret = allocator.alloc<Call>();
   ret->target = target;
-  ret->type = functionTypes[ret->target];
+  // the function may be unknown, which the validator will report
+  auto iter = functionTypes.find(ret->target);
+  ret->type = iter != functionTypes.end() ? iter->second : none;
   parseCallOperands(s, 2, s.size(), ret);
   ret->finalize();
   return ret;
@@ -656,6 +656,10 @@ void WasmValidator::validateBinaryenIR(Module& wasm) {
 
     BinaryenIRValidator(WasmValidator& parent) : parent(parent) {}
 
+    void walkFunction(Function* func) {
+      if (!func->isLazy()) PostWalker<BinaryenIRValidator, UnifiedExpressionVisitor<BinaryenIRValidator>>::walkFunction(func);
+    }
+
     void visitExpression(Expression* curr) {
       // check if a node type is 'stale', i.e., we forgot to finalize() the node.
       auto oldType = curr->type;
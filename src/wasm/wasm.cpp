@@ -547,6 +547,13 @@ bool Function::hasLocalName(Index index) const {
   return index < localNames.size() && localNames[index].is();
 }
 
+void Function::doMaterialize() {
+  // keep the decoder alive while it decodes, as it may be the last reference
+  auto decoder = lazyBody->decoder;
+  decoder->decode(this);
+  lazyBody.reset();
+}
+
 Name Function::getLocalName(Index index) {
   assert(hasLocalName(index));
   return localNames[index];
@@ -580,93 +587,88 @@ WasmType Function::getLocalType(Index index) {
 }
 
 FunctionType* Module::getFunctionType(Name name) {
-  assert(functionTypesMap.count(name));
-  return functionTypesMap[name];
+  auto* ret = functionTypesMap.get(name);
+  assert(ret);
+  return ret;
 }
 
 Import* Module::getImport(Name name) {
-  assert(importsMap.count(name));
-  return importsMap[name];
+  auto* ret = importsMap.get(name);
+  assert(ret);
+  return ret;
 }
 
 Export* Module::getExport(Name name) {
-  assert(exportsMap.count(name));
-  return exportsMap[name];
+  auto* ret = exportsMap.get(name);
+  assert(ret);
+  return ret;
 }
 
 Function* Module::getFunction(Name name) {
-  assert(functionsMap.count(name));
-  return functionsMap[name];
+  auto* ret = functionsMap.get(name);
+  assert(ret);
+  return ret;
 }
 
 Global* Module::getGlobal(Name name) {
-  assert(globalsMap.count(name));
-  return globalsMap[name];
+  auto* ret = globalsMap.get(name);
+  assert(ret);
+  return ret;
 }
 
 FunctionType* Module::getFunctionTypeOrNull(Name name) {
-  if (!functionTypesMap.count(name))
-    return nullptr;
-  return functionTypesMap[name];
+  return functionTypesMap.get(name);
 }
 
 Import* Module::getImportOrNull(Name name) {
-  if (!importsMap.count(name))
-    return nullptr;
-  return importsMap[name];
+  return importsMap.get(name);
 }
 
 Export* Module::getExportOrNull(Name name) {
-  if (!exportsMap.count(name))
-    return nullptr;
-  return exportsMap[name];
+  return exportsMap.get(name);
 }
 
 Function* Module::getFunctionOrNull(Name name) {
-  if (!functionsMap.count(name))
-    return nullptr;
-  return functionsMap[name];
+  return functionsMap.get(name);
 }
 
 Global* Module::getGlobalOrNull(Name name) {
-  if (!globalsMap.count(name))
-    return nullptr;
-  return globalsMap[name];
+  return globalsMap.get(name);
 }
 
 void Module::addFunctionType(FunctionType* curr) {
   assert(curr->name.is());
   functionTypes.push_back(std::unique_ptr<FunctionType>(curr));
-  assert(functionTypesMap.find(curr->name) == functionTypesMap.end());
-  functionTypesMap[curr->name] = curr;
+  assert(!functionTypesMap.has(curr->name));
+  functionTypesMap.set(curr->name, curr);
 }
 
 void Module::addImport(Import* curr) {
   assert(curr->name.is());
   imports.push_back(std::unique_ptr<Import>(curr));
-  assert(importsMap.find(curr->name) == importsMap.end());
-  importsMap[curr->name] = curr;
+  assert(!importsMap.has(curr->name));
+  importsMap.set(curr->name, curr);
 }
 
 void Module::addExport(Export* curr) {
   assert(curr->name.is());
   exports.push_back(std::unique_ptr<Export>(curr));
-  assert(exportsMap.find(curr->name) == exportsMap.end());
-  exportsMap[curr->name] = curr;
+  assert(!exportsMap.has(curr->name));
+  exportsMap.set(curr->name, curr);
 }
 
 void Module::addFunction(Function* curr) {
   assert(curr->name.is());
   functions.push_back(std::unique_ptr<Function>(curr));
-  assert(functionsMap.find(curr->name) == functionsMap.end());
-  functionsMap[curr->name] = curr;
+  assert(!functionsMap.has(curr->name));
+  functionsMap.set(curr->name, curr);
 }
 
 void Module::addGlobal(Global* curr) {
   assert(curr->name.is());
   globals.push_back(std::unique_ptr<Global>(curr));
-  assert(globalsMap.find(curr->name) == globalsMap.end());
-  globalsMap[curr->name] = curr;
+  assert(!globalsMap.has(curr->name));
+  globalsMap.set(curr->name, curr);
 }
 
 void Module::addStart(const Name& s) {
@@ -697,24 +699,29 @@ void Module::removeExport(Name name) {
 
 void Module::updateMaps() {
   functionsMap.clear();
+  functionsMap.reserve(functions.size());
   for (auto& curr : functions) {
-    functionsMap[curr->name] = curr.get();
+    functionsMap.set(curr->name, curr.get());
   }
   functionTypesMap.clear();
+  functionTypesMap.reserve(functionTypes.size());
   for (auto& curr : functionTypes) {
-    functionTypesMap[curr->name] = curr.get();
+    functionTypesMap.set(curr->name, curr.get());
   }
   importsMap.clear();
+  importsMap.reserve(imports.size());
   for (auto& curr : imports) {
-    importsMap[curr->name] = curr.get();
+    importsMap.set(curr->name, curr.get());
   }
   exportsMap.clear();
+  exportsMap.reserve(exports.size());
   for (auto& curr : exports) {
-    exportsMap[curr->name] = curr.get();
+    exportsMap.set(curr->name, curr.get());
   }
   globalsMap.clear();
+  globalsMap.reserve(globals.size());
   for (auto& curr : globals) {
-    globalsMap[curr->name] = curr.get();
+    globalsMap.set(curr->name, curr.get());
   }
 }
 
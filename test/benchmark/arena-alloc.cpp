@@ -0,0 +1,62 @@
+// Allocates many small nodes in a module's arena from the workers of the
+// ThreadPool, as function-parallel passes do when they build new code.
+// Each worker alternates between the module's arena and a second one, like
+// a pass that allocates both in the module and in some temporary arena.
+//
+// usage: BINARYEN_CORES=N arena-alloc [nodes per worker]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "wasm.h"
+#include "wasm-builder.h"
+#include "support/threads.h"
+
+using namespace wasm;
+
+int main(int argc, const char* argv[]) {
+  size_t numNodes = argc > 1 ? std::stoi(argv[1]) : 10000000;
+
+  Module module;
+  MixedArena other;
+  auto* pool = ThreadPool::get();
+  size_t numWorkers = pool->size();
+
+  auto run = [&]() {
+    std::vector<Const*> last(numWorkers);
+    std::vector<std::function<ThreadWorkState ()>> doWorkers;
+    for (size_t i = 0; i < numWorkers; i++) {
+      doWorkers.push_back([&, i]() {
+        Builder builder(module);
+        Const* curr = nullptr;
+        for (size_t j = 0; j < numNodes; j++) {
+          curr = builder.makeConst(Literal(int32_t(j)));
+          if ((j & 15) == 0) {
+            other.alloc<Nop>();
+          }
+        }
+        last[i] = curr;
+        return ThreadWorkState::Finished;
+      });
+    }
+    auto before = std::chrono::steady_clock::now();
+    pool->work(doWorkers);
+    auto after = std::chrono::steady_clock::now();
+    for (auto* curr : last) {
+      if (curr->value.geti32() != int32_t(numNodes - 1)) {
+        std::cerr << "bad allocation\n";
+        exit(1);
+      }
+    }
+    return std::chrono::duration<double>(after - before).count();
+  };
+
+  // the first round also builds up the per-thread arenas
+  run();
+  double seconds = run();
+  std::cout << "allocated " << (numWorkers * numNodes) << " nodes on " << numWorkers
+            << " workers in " << seconds << " seconds ("
+            << (numWorkers * numNodes / seconds / 1e6) << " M/s)\n";
+}
@@ -0,0 +1,98 @@
+// Reads a wasm binary into a Module, repeatedly. By default the binary is
+// a synthetic module heavy in the immediates the reader decodes most:
+// local and function indexes, constants of all sizes, and memory offsets.
+//
+// usage: binary-read [repetitions] [input.wasm]
+//
+// Use BINARYEN_CORES=1 to time decoding alone, without parallelism.
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "wasm.h"
+#include "wasm-binary.h"
+#include "wasm-builder.h"
+#include "support/file.h"
+
+using namespace wasm;
+
+static void makeModule(Module& module) {
+  Builder builder(module);
+  const Index numFunctions = 20000;
+  const Index numStatements = 50;
+  module.memory.exists = true;
+  module.memory.initial = module.memory.max = 1;
+  for (Index i = 0; i < numFunctions; i++) {
+    Name name = Name::fromInt(i);
+    auto* body = builder.makeBlock();
+    for (Index j = 0; j < numStatements; j++) {
+      Index local = j % 16;
+      // constants of 1 to 5 LEB bytes
+      int32_t value = int32_t(j * 977) << (j % 24);
+      Expression* curr = builder.makeBinary(AddInt32,
+        builder.makeGetLocal(local, i32),
+        builder.makeConst(Literal(value))
+      );
+      if (j % 5 == 0) {
+        curr = builder.makeBinary(AddInt32,
+          curr,
+          builder.makeLoad(4, false, j * 8, 4, builder.makeConst(Literal(int32_t(j))), i32)
+        );
+      }
+      if (j % 7 == 0) {
+        curr = builder.makeUnary(WrapInt64,
+          builder.makeBinary(MulInt64,
+            builder.makeUnary(ExtendSInt32, curr),
+            builder.makeConst(Literal(int64_t(value) << 20))
+          )
+        );
+      }
+      if (j % 11 == 0 && i > 0) {
+        curr = builder.makeCall(Name::fromInt(i - 1), { curr }, i32);
+      }
+      body->list.push_back(builder.makeSetLocal(local, curr));
+    }
+    body->list.push_back(builder.makeGetLocal(0, i32));
+    body->finalize(i32);
+    std::vector<NameType> vars;
+    for (Index j = 1; j < 16; j++) {
+      vars.emplace_back(Name("var$" + std::to_string(j)), i32);
+    }
+    auto* func = builder.makeFunction(name, { NameType("var$0", i32) }, i32, std::move(vars), body);
+    module.addFunction(func);
+  }
+}
+
+int main(int argc, const char* argv[]) {
+  size_t repetitions = argc > 1 ? std::stoi(argv[1]) : 5;
+
+  std::vector<char> input;
+  if (argc > 2) {
+    input = read_file<std::vector<char>>(argv[2], Flags::Binary, Flags::Release);
+  } else {
+    Module module;
+    makeModule(module);
+    BufferWithRandomAccess buffer(false);
+    WasmBinaryWriter writer(&module, buffer, false);
+    writer.write();
+    input.assign(buffer.begin(), buffer.end());
+  }
+
+  size_t numFunctions = 0;
+  double best = 0;
+  for (size_t i = 0; i < repetitions; i++) {
+    Module module;
+    auto before = std::chrono::steady_clock::now();
+    WasmBinaryBuilder parser(module, input, false);
+    parser.read();
+    auto after = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(after - before).count();
+    if (i == 0 || seconds < best) best = seconds;
+    numFunctions = module.functions.size();
+  }
+  std::cout << "read " << input.size() << " bytes (" << numFunctions << " functions) in "
+            << best << " seconds (best of " << repetitions << ", "
+            << (input.size() / best / (1024 * 1024)) << " MB/s)\n";
+}
@@ -0,0 +1,72 @@
+// Writes a Module as a wasm binary, repeatedly, with sizes padded to 5-byte
+// LEBs and with sizes compacted to their minimal encoding, and reports the
+// output size and write time of each. By default the module is synthetic,
+// with many small functions, where size fields are a large part of the
+// output.
+//
+// usage: binary-write [repetitions] [input.wasm]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "wasm.h"
+#include "wasm-binary.h"
+#include "wasm-builder.h"
+#include "support/file.h"
+
+using namespace wasm;
+
+static void makeModule(Module& module) {
+  Builder builder(module);
+  const Index numFunctions = 200000;
+  for (Index i = 0; i < numFunctions; i++) {
+    Index size = i % 8;
+    auto* body = builder.makeBlock();
+    for (Index j = 0; j <= size; j++) {
+      body->list.push_back(builder.makeSetLocal(0,
+        builder.makeBinary(AddInt32,
+          builder.makeGetLocal(0, i32),
+          builder.makeConst(Literal(int32_t(i + j)))
+        )
+      ));
+    }
+    body->list.push_back(builder.makeGetLocal(0, i32));
+    body->finalize(i32);
+    auto* func = builder.makeFunction(Name::fromInt(i), { NameType("x", i32) }, i32, {}, body);
+    module.addFunction(func);
+  }
+}
+
+int main(int argc, const char* argv[]) {
+  size_t repetitions = argc > 1 ? std::stoi(argv[1]) : 5;
+
+  Module module;
+  if (argc > 2) {
+    auto input = read_file<std::vector<char>>(argv[2], Flags::Binary, Flags::Release);
+    WasmBinaryBuilder parser(module, input, false);
+    parser.read();
+  } else {
+    makeModule(module);
+  }
+
+  for (bool compact : { false, true }) {
+    size_t size = 0;
+    double best = 0;
+    for (size_t i = 0; i < repetitions; i++) {
+      BufferWithRandomAccess buffer(false);
+      auto before = std::chrono::steady_clock::now();
+      WasmBinaryWriter writer(&module, buffer, false);
+      writer.setCompactSizes(compact);
+      writer.write();
+      auto after = std::chrono::steady_clock::now();
+      double seconds = std::chrono::duration<double>(after - before).count();
+      if (i == 0 || seconds < best) best = seconds;
+      size = buffer.size();
+    }
+    std::cout << (compact ? "compact" : "padded ") << " sizes: wrote " << size << " bytes ("
+              << module.functions.size() << " functions) in " << best
+              << " seconds (best of " << repetitions << ")\n";
+  }
+}
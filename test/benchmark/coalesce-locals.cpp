@@ -0,0 +1,93 @@
+// Runs coalesce-locals on functions with more and more locals, and reports
+// the time of each and the peak memory use so far. Each local is set once, in
+// a loop, from the previous local of its type and one a little before that, so
+// the interferences and copies grow linearly with the number of locals. Last,
+// the pass runs on many functions with a few locals each, as most are.
+//
+// usage: coalesce-locals [max locals]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <sys/resource.h>
+
+#include "wasm.h"
+#include "wasm-builder.h"
+#include "pass.h"
+
+using namespace wasm;
+
+static Function* makeFunction(Builder& builder, Name name, Index numVars) {
+  std::vector<NameType> vars;
+  for (Index i = 0; i < numVars; i++) {
+    vars.emplace_back(Name::fromInt(i), i % 3 == 2 ? f64 : i32);
+  }
+  auto* func = builder.makeFunction(name, { NameType("x", i32), NameType("y", f64) }, i32, std::move(vars));
+  // the locals of each type, starting with the param
+  std::vector<Index> ofType[2] = { { 0 }, { 1 } };
+  auto* body = builder.makeBlock();
+  for (Index i = 0; i < numVars; i++) {
+    Index index = 2 + i;
+    auto type = func->getLocalType(index);
+    auto& previous = ofType[type == f64];
+    Index last = previous.back();
+    Index before = previous[previous.size() - 1 - (i * 7919) % std::min(Index(previous.size()), Index(16))];
+    Expression* value;
+    if (i % 8 == 0) {
+      // a copy
+      value = builder.makeGetLocal(last, type);
+    } else {
+      value = builder.makeBinary(type == f64 ? AddFloat64 : AddInt32, builder.makeGetLocal(last, type), builder.makeGetLocal(before, type));
+    }
+    body->list.push_back(builder.makeSetLocal(index, value));
+    previous.push_back(index);
+  }
+  body->list.push_back(builder.makeBreak("top", nullptr, builder.makeUnary(EqZInt32, builder.makeGetLocal(ofType[0].back(), i32))));
+  body->finalize();
+  func->body = builder.makeSequence(
+    builder.makeLoop("top", body),
+    builder.makeBinary(AddInt32,
+      builder.makeGetLocal(ofType[0].back(), i32),
+      builder.makeUnary(TruncSFloat64ToInt32, builder.makeGetLocal(ofType[1].back(), f64))
+    )
+  );
+  return func;
+}
+
+static double run(Module& module) {
+  PassRunner runner(&module);
+  runner.add("coalesce-locals");
+  auto before = std::chrono::steady_clock::now();
+  runner.run();
+  auto after = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(after - before).count();
+}
+
+static long peakMegabytes() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024;
+}
+
+int main(int argc, const char* argv[]) {
+  Index maxLocals = argc > 1 ? std::stoi(argv[1]) : 64000;
+
+  for (Index numLocals = 1000; numLocals <= maxLocals; numLocals *= 2) {
+    Module module;
+    Builder builder(module);
+    module.addFunction(makeFunction(builder, "big", numLocals));
+    double seconds = run(module);
+    std::cout << numLocals << " locals: " << seconds << " seconds (" << (seconds * 1e9 / numLocals)
+              << " ns per local), peak memory so far " << peakMegabytes() << " MB\n";
+  }
+
+  Module module;
+  Builder builder(module);
+  const Index numFunctions = 20000;
+  for (Index i = 0; i < numFunctions; i++) {
+    module.addFunction(makeFunction(builder, Name::fromInt(i), 2 + i % 16));
+  }
+  double seconds = run(module);
+  std::cout << numFunctions << " functions with 2-17 locals: " << seconds << " seconds ("
+            << (seconds * 1e9 / numFunctions) << " ns per function)\n";
+}
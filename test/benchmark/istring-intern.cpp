@@ -0,0 +1,57 @@
+// Interns many fresh names from several threads at once, as asm2wasm and
+// the parallel passes do when they create labels and locals.
+//
+// usage: istring-intern [threads] [names per thread]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "emscripten-optimizer/istring.h"
+
+using namespace cashew;
+
+int main(int argc, const char* argv[]) {
+  size_t numThreads = argc > 1 ? std::stoi(argv[1]) : std::max(1U, std::thread::hardware_concurrency());
+  size_t numNames = argc > 2 ? std::stoi(argv[2]) : 1000000;
+
+  // build the names ahead of time, so we time only the interning. half
+  // of each thread's names are shared with the other threads.
+  std::vector<std::vector<std::string>> names(numThreads);
+  for (size_t t = 0; t < numThreads; t++) {
+    for (size_t i = 0; i < numNames; i++) {
+      if (i & 1) {
+        names[t].push_back("shared$" + std::to_string(i));
+      } else {
+        names[t].push_back("label$" + std::to_string(t) + "$" + std::to_string(i));
+      }
+    }
+  }
+
+  auto before = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; t++) {
+    threads.emplace_back([&names, t]() {
+      for (auto& name : names[t]) {
+        IString(name.c_str(), false);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto after = std::chrono::steady_clock::now();
+
+  std::chrono::duration<double> diff = after - before;
+  std::cout << "interned " << (numThreads * numNames) << " names on " << numThreads
+            << " threads in " << diff.count() << " seconds ("
+            << (numThreads * numNames / diff.count() / 1e6) << " M/s)\n";
+
+  // sanity check: the same string always interns to the same pointer
+  if (IString("shared$1", false) != IString(names[0][1].c_str(), false)) {
+    std::cerr << "interning mismatch\n";
+    return 1;
+  }
+}
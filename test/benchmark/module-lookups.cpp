@@ -0,0 +1,103 @@
+// Builds a module with many functions, imports, globals and exports, and
+// times the kinds of lookups that wasm-merge and the linker do on it: name
+// collision checks that mostly miss, and resolution of names that hit.
+//
+// usage: module-lookups [number of functions]
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "wasm.h"
+#include "wasm-builder.h"
+
+using namespace wasm;
+
+struct Timer {
+  std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+
+  void report(const char* what) {
+    auto after = std::chrono::steady_clock::now();
+    std::chrono::duration<double> diff = after - before;
+    std::cout << what << ": " << diff.count() << " seconds\n";
+    before = after;
+  }
+};
+
+int main(int argc, const char* argv[]) {
+  size_t num = argc > 1 ? std::stoi(argv[1]) : 500000;
+
+  // intern all the names ahead of time, so we time only the module
+  std::vector<Name> functionNames, importNames, globalNames, otherNames;
+  for (size_t i = 0; i < num; i++) {
+    functionNames.push_back(Name("func$" + std::to_string(i)));
+    importNames.push_back(Name("import$" + std::to_string(i)));
+    globalNames.push_back(Name("global$" + std::to_string(i)));
+    otherNames.push_back(Name("other$" + std::to_string(i)));
+  }
+
+  Module wasm;
+  Builder builder(wasm);
+  Timer timer;
+
+  for (size_t i = 0; i < num; i++) {
+    wasm.addFunction(builder.makeFunction(functionNames[i], std::vector<NameType>{}, none, std::vector<NameType>{}, builder.makeNop()));
+  }
+  timer.report("addFunction");
+  for (size_t i = 0; i < num; i++) {
+    auto* import = new Import;
+    import->name = importNames[i];
+    import->module = Name("env");
+    import->base = importNames[i];
+    import->kind = ExternalKind::Function;
+    wasm.addImport(import);
+    auto* global = new Global;
+    global->name = globalNames[i];
+    global->type = i32;
+    global->init = builder.makeConst(Literal(int32_t(0)));
+    global->mutable_ = false;
+    wasm.addGlobal(global);
+    auto* export_ = new Export;
+    export_->name = functionNames[i];
+    export_->value = functionNames[i];
+    export_->kind = ExternalKind::Function;
+    wasm.addExport(export_);
+  }
+  timer.report("addImport, addGlobal, addExport");
+
+  // look things up in a random order, as merging and relocation do not
+  // visit names in the order they were added
+  std::vector<size_t> order;
+  for (size_t i = 0; i < num; i++) {
+    order.push_back(i);
+  }
+  std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+  size_t found = 0;
+  for (auto i : order) {
+    found += wasm.getFunction(functionNames[i]) != nullptr;
+    found += wasm.getImport(importNames[i]) != nullptr;
+    found += wasm.getGlobal(globalNames[i]) != nullptr;
+    found += wasm.getExport(functionNames[i]) != nullptr;
+  }
+  timer.report("lookups that hit");
+
+  // wasm-merge checks each incoming name against the output module
+  for (auto i : order) {
+    found += wasm.getImportOrNull(otherNames[i]) != nullptr;
+    found += wasm.getFunctionOrNull(otherNames[i]) != nullptr;
+    found += wasm.getGlobalOrNull(otherNames[i]) != nullptr;
+  }
+  timer.report("lookups that miss");
+
+  wasm.updateMaps();
+  timer.report("updateMaps");
+
+  if (found != num * 4) {
+    std::cerr << "unexpected lookup results\n";
+    return 1;
+  }
+}
@@ -0,0 +1,72 @@
+// Runs the passes that look at the effects of code many times on deeply
+// nested code, at doubling depths, and reports the time of each. Each level of
+// nesting is looked at by the pass, as are the effects of what is below it, so
+// unless those effects are remembered a pass takes quadratic time.
+//
+// usage: nested-effects [max depth]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "wasm.h"
+#include "wasm-builder.h"
+#include "pass.h"
+
+using namespace wasm;
+
+// A dropped chain of adds and selects with a call at the bottom, which
+// vacuum and merge-blocks must look through.
+static Expression* makeEffectfulChain(Builder& builder, Index depth) {
+  Expression* curr = builder.makeCall("leaf", {}, i32);
+  for (Index i = 0; i < depth; i++) {
+    if (i & 1) {
+      curr = builder.makeBinary(AddInt32, curr, builder.makeConst(Literal(int32_t(i))));
+    } else {
+      curr = builder.makeSelect(builder.makeGetLocal(0, i32), curr, builder.makeConst(Literal(int32_t(i))));
+    }
+  }
+  return builder.makeDrop(curr);
+}
+
+// A chain of if-elses, which remove-unused-brs turns into selects when
+// shrinking.
+static Expression* makeIfChain(Builder& builder, Index depth) {
+  Expression* curr = builder.makeConst(Literal(int32_t(0)));
+  for (Index i = 0; i < depth; i++) {
+    curr = builder.makeIf(builder.makeGetLocal(0, i32), builder.makeConst(Literal(int32_t(i))), curr);
+  }
+  return builder.makeSetLocal(1, curr);
+}
+
+static void makeModule(Module& module, Index depth) {
+  Builder builder(module);
+  module.addFunction(builder.makeFunction("leaf", {}, i32, {}, builder.makeConst(Literal(int32_t(1)))));
+  auto* body = builder.makeBlock();
+  body->list.push_back(makeEffectfulChain(builder, depth));
+  body->list.push_back(makeIfChain(builder, depth));
+  body->list.push_back(builder.makeGetLocal(1, i32));
+  body->finalize(i32);
+  module.addFunction(builder.makeFunction("nested", { NameType("x", i32) }, i32, { NameType("y", i32) }, body));
+}
+
+int main(int argc, const char* argv[]) {
+  Index maxDepth = argc > 1 ? std::stoi(argv[1]) : 16000;
+
+  for (auto* pass : { "merge-blocks", "vacuum", "remove-unused-brs" }) {
+    for (Index depth = 1000; depth <= maxDepth; depth *= 2) {
+      Module module;
+      makeModule(module, depth);
+      PassOptions options;
+      options.shrinkLevel = 1;
+      PassRunner runner(&module, options);
+      runner.add(pass);
+      auto before = std::chrono::steady_clock::now();
+      runner.run();
+      auto after = std::chrono::steady_clock::now();
+      double seconds = std::chrono::duration<double>(after - before).count();
+      std::cout << pass << ", depth " << depth << ": " << seconds << " seconds ("
+                << (seconds * 1e9 / depth) << " ns per level)\n";
+    }
+  }
+}
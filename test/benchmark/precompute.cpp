@@ -0,0 +1,61 @@
+// Runs the precompute pass on deeply nested arithmetic, at doubling depths,
+// and reports the time of each. The innermost expression is either a local,
+// which is not constant, or a division by zero, which traps, so nothing can
+// be precomputed except the constants around it; a linear-time pass should
+// take about twice as long for each doubling.
+//
+// usage: precompute [max depth]
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "wasm.h"
+#include "wasm-builder.h"
+#include "pass.h"
+
+using namespace wasm;
+
+static Expression* makeNested(Builder& builder, Index depth, bool trapping) {
+  Expression* curr;
+  if (trapping) {
+    curr = builder.makeBinary(DivSInt32, builder.makeConst(Literal(int32_t(1))), builder.makeConst(Literal(int32_t(0))));
+  } else {
+    curr = builder.makeGetLocal(0, i32);
+  }
+  for (Index i = 0; i < depth; i++) {
+    // alternate the sides, and give each level a constant subtree to fold
+    auto* constant = builder.makeBinary(MulInt32, builder.makeConst(Literal(int32_t(i))), builder.makeConst(Literal(int32_t(3))));
+    if (i & 1) {
+      curr = builder.makeBinary(AddInt32, curr, constant);
+    } else {
+      curr = builder.makeBinary(XorInt32, constant, curr);
+    }
+  }
+  return curr;
+}
+
+int main(int argc, const char* argv[]) {
+  Index maxDepth = argc > 1 ? std::stoi(argv[1]) : 16000;
+
+  for (bool trapping : { false, true }) {
+    for (Index depth = 1000; depth <= maxDepth; depth *= 2) {
+      Module module;
+      Builder builder(module);
+      // a few functions, so that small depths take long enough to time
+      const Index numFunctions = 4;
+      for (Index i = 0; i < numFunctions; i++) {
+        auto* func = builder.makeFunction(Name::fromInt(i), { NameType("x", i32) }, i32, {}, makeNested(builder, depth, trapping));
+        module.addFunction(func);
+      }
+      PassRunner runner(&module);
+      runner.add("precompute");
+      auto before = std::chrono::steady_clock::now();
+      runner.run();
+      auto after = std::chrono::steady_clock::now();
+      double seconds = std::chrono::duration<double>(after - before).count();
+      std::cout << (trapping ? "trapping" : "local   ") << " leaf, depth " << depth << ": "
+                << seconds << " seconds (" << (seconds * 1e9 / (depth * numFunctions)) << " ns per level)\n";
+    }
+  }
+}
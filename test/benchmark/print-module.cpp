@@ -0,0 +1,102 @@
+// Prints a Module in the text format, repeatedly, and reports the output size
+// and print time. The module is printed normally, then its function bodies
+// minified, then the module in full. By default the module is synthetic, with many small
+// functions full of names, indexes and constants of every type.
+//
+// usage: print-module [repetitions] [input.wasm]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "wasm.h"
+#include "wasm-binary.h"
+#include "wasm-builder.h"
+#include "wasm-printing.h"
+#include "pass.h"
+#include "support/file.h"
+
+using namespace wasm;
+
+static void makeModule(Module& module) {
+  Builder builder(module);
+  const Index numFunctions = 50000;
+  for (Index i = 0; i < numFunctions; i++) {
+    auto* body = builder.makeBlock();
+    for (Index j = 0; j <= i % 8; j++) {
+      body->list.push_back(builder.makeSetLocal(0,
+        builder.makeBinary(AddInt32,
+          builder.makeGetLocal(0, i32),
+          builder.makeConst(Literal(int32_t(i * 7919 + j)))
+        )
+      ));
+      body->list.push_back(builder.makeSetLocal(1,
+        builder.makeBinary(MulFloat64,
+          builder.makeGetLocal(1, f64),
+          builder.makeConst(Literal(double(i) / (j + 3)))
+        )
+      ));
+      body->list.push_back(builder.makeStore(4, j * 4, 4,
+        builder.makeConst(Literal(int32_t(1024))),
+        builder.makeConst(Literal(float(j) * 0.1f)),
+        f32
+      ));
+    }
+    if (i > 0) {
+      body->list.push_back(builder.makeDrop(
+        builder.makeCall(Name::fromInt(i - 1), { builder.makeGetLocal(0, i32), builder.makeGetLocal(1, f64) }, i32)
+      ));
+    }
+    body->list.push_back(builder.makeGetLocal(0, i32));
+    body->finalize(i32);
+    auto* func = builder.makeFunction(Name::fromInt(i), { NameType("x", i32), NameType("y", f64) }, i32, {}, body);
+    module.addFunction(func);
+  }
+  module.memory.exists = true;
+  module.memory.initial = 1;
+}
+
+int main(int argc, const char* argv[]) {
+  size_t repetitions = argc > 1 ? std::stoi(argv[1]) : 5;
+
+  Module module;
+  if (argc > 2) {
+    auto input = read_file<std::vector<char>>(argv[2], Flags::Binary, Flags::Release);
+    WasmBinaryBuilder parser(module, input, false);
+    parser.read();
+  } else {
+    makeModule(module);
+  }
+
+  const char* modes[] = { "print", "print-minified bodies", "print-full" };
+  for (auto* mode : modes) {
+    if (mode == modes[2]) {
+      // the printer checks this each time it starts
+      setenv("BINARYEN_PRINT_FULL", "1", 1);
+    }
+    size_t size = 0;
+    double best = 0;
+    for (size_t i = 0; i < repetitions; i++) {
+      std::ostringstream output;
+      auto before = std::chrono::steady_clock::now();
+      if (mode == modes[1]) {
+        for (auto& func : module.functions) {
+          WasmPrinter::printExpression(func->body, output, true);
+        }
+      } else {
+        Printer(&output).run(nullptr, &module);
+      }
+      auto after = std::chrono::steady_clock::now();
+      double seconds = std::chrono::duration<double>(after - before).count();
+      if (i == 0 || seconds < best) best = seconds;
+      size = output.tellp();
+    }
+    double megabytes = size / (1024.0 * 1024.0);
+    std::cout << mode << ": wrote " << megabytes << " MB (" << module.functions.size()
+              << " functions) in " << best << " seconds (best of " << repetitions << ", "
+              << (megabytes / best) << " MB/s)\n";
+  }
+}
@@ -0,0 +1,77 @@
+// Parses text-format files into s-expressions, repeatedly, and then once
+// more into Modules. Any files that are not single modules, like the spec
+// tests, are only tokenized.
+//
+// usage: sexpr-parse [repetitions] FILE...
+//
+// for example, sexpr-parse 10 test/*.wast test/passes/*.wast
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "wasm.h"
+#include "wasm-s-parser.h"
+#include "support/file.h"
+
+using namespace wasm;
+
+int main(int argc, const char* argv[]) {
+  if (argc < 3) {
+    std::cerr << "usage: sexpr-parse [repetitions] FILE...\n";
+    return 1;
+  }
+  size_t repetitions = std::stoi(argv[1]);
+  std::vector<std::string> inputs;
+  size_t totalSize = 0;
+  for (int i = 2; i < argc; i++) {
+    inputs.push_back(read_file<std::string>(argv[i], Flags::Text, Flags::Release));
+    totalSize += inputs.back().size();
+  }
+
+  // tokenizing modifies the input, so each repetition gets a fresh copy
+  size_t bad = 0;
+  std::chrono::duration<double> tokenizing(0);
+  for (size_t r = 0; r < repetitions; r++) {
+    for (auto& input : inputs) {
+      std::string copy = input;
+      auto before = std::chrono::steady_clock::now();
+      try {
+        SExpressionParser parser(const_cast<char*>(copy.c_str()));
+      } catch (ParseException& p) {
+        bad++;
+      }
+      tokenizing += std::chrono::steady_clock::now() - before;
+    }
+  }
+
+  size_t modules = 0;
+  std::chrono::duration<double> building(0);
+  for (auto& input : inputs) {
+    std::string copy = input;
+    auto before = std::chrono::steady_clock::now();
+    try {
+      SExpressionParser parser(const_cast<char*>(copy.c_str()));
+      Element& root = *parser.root;
+      if (root.size() == 1 && root[0]->isList() && root[0]->size() > 0 && (*root[0])[0]->isStr() && (*root[0])[0]->str() == MODULE) {
+        Module wasm;
+        SExpressionWasmBuilder builder(wasm, *root[0]);
+        modules++;
+      }
+    } catch (ParseException& p) {
+      // not something we can build, like a file of spec test commands
+    }
+    building += std::chrono::steady_clock::now() - before;
+  }
+
+  double megabytes = totalSize / (1024.0 * 1024.0);
+  std::cout << "tokenized " << inputs.size() << " files (" << megabytes << " MB) " << repetitions
+            << " times in " << tokenizing.count() << " seconds ("
+            << (megabytes * repetitions / tokenizing.count()) << " MB/s)\n";
+  std::cout << "parsed and built " << modules << " modules in " << building.count() << " seconds ("
+            << (megabytes / building.count()) << " MB/s)\n";
+  if (bad > 0) {
+    std::cerr << (bad / repetitions) << " files failed to tokenize\n";
+  }
+}
@@ -0,0 +1,40 @@
+(module
+  (memory 1 10)
+  (data (i32.const 10) "waka")
+  (global $g (mut i32) (i32.const 100))
+  (table 1 1 anyfunc)
+  (elem (i32.const 0) $grow)
+  (func $ret (export "ret") (result i32)
+    (block $out (result i32)
+      (drop (call $ret))
+      (if (call $ret)
+        (return
+          (return
+            (i32.const 1)
+          )
+        )
+      )
+      (drop (br_if $out (i32.const 999) (i32.const 1)))
+      (unreachable)
+    )
+  )
+  (func $grow (export "grow") (param $x i32) (result i32)
+    (local $y i32)
+    (set_local $y
+      (i32.add
+        (get_global $g)
+        (i32.mul (get_local $x) (i32.const 2))
+      )
+    )
+    (set_global $g (get_local $y))
+    (if (i32.eqz (get_local $y))
+      (drop (grow_memory (get_local $y)))
+    )
+    (i32.add (get_local $y) (i32.add (i32.const 1) (i32.const 2)))
+  )
+  (func $loop (export "loop") (param $x i32)
+    (loop $l
+      (br_if $l (i32.load8_u (i32.add (get_local $x) (i32.const 4))))
+    )
+  )
+)